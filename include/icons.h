@@ -0,0 +1,83 @@
+// Generated by png2atlas.py from sun.png, moon.png, sun_cloud.png, cloud.png, rain.png, thunder.png, snow.png, mist.png, twitter.png, youtube.png, bitcoin.png, ethereum.png, coin.png -- don't edit.
+
+#ifndef ICONS_H
+#define ICONS_H
+
+#include <RGBmatrixPanel4.h>
+
+#define ICONS_SUN 0 // 8x7
+#define ICONS_MOON 1 // 8x7
+#define ICONS_SUN_CLOUD 2 // 8x7
+#define ICONS_CLOUD 3 // 8x7
+#define ICONS_RAIN 4 // 8x7
+#define ICONS_THUNDER 5 // 8x7
+#define ICONS_SNOW 6 // 8x7
+#define ICONS_MIST 7 // 8x7
+#define ICONS_TWITTER 8 // 8x7
+#define ICONS_YOUTUBE 9 // 8x7
+#define ICONS_BITCOIN 10 // 8x7
+#define ICONS_ETHEREUM 11 // 8x7
+#define ICONS_COIN 12 // 8x7
+
+static const uint16_t icons_palette[] PROGMEM = {
+  0x72E0, 0x73AE, 0x4229, 0x014E, 0x0A4E, 0x7000, 0x71C0, 0x40EE
+};
+
+static const uint8_t icons_data[] PROGMEM = { // 387 bytes
+  0x80, 0x00, 0x01, 0x80, 0x00, 0x01, 0x80, 0x00, 0x01, 0x80, 0x00, 0x00,
+  0x80, 0x00, 0x00, 0x80, 0x00, 0x03, 0x82, 0x00, 0x02, 0x86, 0x00, 0x02,
+  0x82, 0x00, 0x03, 0x80, 0x00, 0x00, 0x80, 0x00, 0x00, 0x80, 0x00, 0x01,
+  0x80, 0x00, 0x01, 0x80, 0x00, 0x01, 0x80, 0x00, 0x00, 0x01, 0x82, 0x01,
+  0x03, 0x81, 0x01, 0x04, 0x81, 0x01, 0x05, 0x81, 0x01, 0x05, 0x81, 0x01,
+  0x06, 0x81, 0x01, 0x06, 0x82, 0x01, 0x02, 0x04, 0x80, 0x00, 0x04, 0x80,
+  0x00, 0x00, 0x81, 0x00, 0x02, 0x81, 0x02, 0x00, 0x82, 0x00, 0x00, 0x83,
+  0x02, 0x00, 0x80, 0x00, 0x00, 0x85, 0x02, 0x01, 0x86, 0x02, 0x01, 0x84,
+  0x02, 0x01, 0x0A, 0x81, 0x02, 0x04, 0x83, 0x02, 0x02, 0x85, 0x02, 0x00,
+  0x8F, 0x02, 0x00, 0x85, 0x02, 0x00, 0x01, 0x82, 0x02, 0x03, 0x84, 0x02,
+  0x01, 0x86, 0x02, 0x01, 0x84, 0x02, 0x02, 0x80, 0x03, 0x00, 0x80, 0x03,
+  0x00, 0x80, 0x03, 0x01, 0x80, 0x03, 0x00, 0x80, 0x03, 0x00, 0x80, 0x03,
+  0x0A, 0x01, 0x82, 0x02, 0x03, 0x84, 0x02, 0x01, 0x86, 0x02, 0x01, 0x81,
+  0x02, 0x80, 0x00, 0x81, 0x02, 0x04, 0x80, 0x00, 0x05, 0x81, 0x00, 0x05,
+  0x80, 0x00, 0x04, 0x02, 0x80, 0x01, 0x04, 0x80, 0x01, 0x00, 0x80, 0x01,
+  0x00, 0x80, 0x01, 0x03, 0x82, 0x01, 0x02, 0x82, 0x01, 0x00, 0x82, 0x01,
+  0x02, 0x82, 0x01, 0x03, 0x80, 0x01, 0x00, 0x80, 0x01, 0x00, 0x80, 0x01,
+  0x04, 0x80, 0x01, 0x03, 0x07, 0x85, 0x02, 0x03, 0x85, 0x02, 0x07, 0x85,
+  0x02, 0x03, 0x85, 0x02, 0x07, 0x06, 0x81, 0x04, 0x03, 0x84, 0x04, 0x01,
+  0x82, 0x04, 0x00, 0x86, 0x04, 0x01, 0x85, 0x04, 0x02, 0x83, 0x04, 0x01,
+  0x83, 0x04, 0x03, 0x00, 0x85, 0x05, 0x00, 0x82, 0x05, 0x80, 0x01, 0x86,
+  0x05, 0x81, 0x01, 0x85, 0x05, 0x82, 0x01, 0x84, 0x05, 0x81, 0x01, 0x85,
+  0x05, 0x80, 0x01, 0x83, 0x05, 0x00, 0x85, 0x05, 0x00, 0x01, 0x83, 0x06,
+  0x02, 0x80, 0x06, 0x82, 0x01, 0x81, 0x06, 0x00, 0x81, 0x06, 0x80, 0x01,
+  0x81, 0x06, 0x80, 0x01, 0x83, 0x06, 0x82, 0x01, 0x84, 0x06, 0x80, 0x01,
+  0x81, 0x06, 0x80, 0x01, 0x81, 0x06, 0x00, 0x80, 0x06, 0x82, 0x01, 0x81,
+  0x06, 0x02, 0x83, 0x06, 0x01, 0x02, 0x80, 0x07, 0x05, 0x82, 0x07, 0x03,
+  0x84, 0x07, 0x01, 0x86, 0x07, 0x01, 0x84, 0x07, 0x03, 0x82, 0x07, 0x05,
+  0x80, 0x07, 0x03, 0x01, 0x83, 0x00, 0x02, 0x80, 0x00, 0x83, 0x06, 0x80,
+  0x00, 0x00, 0x80, 0x00, 0x80, 0x06, 0x83, 0x00, 0x80, 0x06, 0x81, 0x00,
+  0x80, 0x06, 0x83, 0x00, 0x80, 0x06, 0x81, 0x00, 0x80, 0x06, 0x83, 0x00,
+  0x80, 0x06, 0x80, 0x00, 0x00, 0x80, 0x00, 0x83, 0x06, 0x80, 0x00, 0x02,
+  0x83, 0x00, 0x01
+};
+
+static const RGBmatrixAtlasEntry icons_entries[] PROGMEM = {
+  { 8, 7, 0 },
+  { 8, 7, 45 },
+  { 8, 7, 67 },
+  { 8, 7, 98 },
+  { 8, 7, 114 },
+  { 8, 7, 145 },
+  { 8, 7, 171 },
+  { 8, 7, 208 },
+  { 8, 7, 221 },
+  { 8, 7, 243 },
+  { 8, 7, 273 },
+  { 8, 7, 317 },
+  { 8, 7, 339 }
+};
+
+// In RAM, drawImage() reads it directly; the tables are PROGMEM
+static const RGBmatrixAtlas icons = {
+  icons_palette, icons_data, icons_entries, 13
+};
+
+#endif // ICONS_H
@@ -0,0 +1,24 @@
+#ifndef SCREENS_H
+#define SCREENS_H
+
+#include <RGBmatrixPanel4.h>
+
+/*
+|--------------------------------------------------------------------------
+| Screen Drawing
+|--------------------------------------------------------------------------
+| Each screen is drawn from values main.cpp has already fetched, so the
+| drawing can run (and be timed) without the network. Banners scroll by one
+| LED per call.
+*/
+
+extern int16_t textX,   //Horizontal cursor position of the scrolling banner.
+               textMin; //How far left the banner scrolls before returning to textX = matrix.width().
+
+void drawTime(RGBmatrixPanel4 &matrix, int hours, int minutes, float seconds, const String &date);
+void drawTwitter(RGBmatrixPanel4 &matrix, int twitterFollowers);
+void drawYoutube(RGBmatrixPanel4 &matrix, const String &subCount);
+void drawWeather(RGBmatrixPanel4 &matrix, const String &location, int main_temp, const char *icon); //icon is OpenWeatherMap's code, e.g. "01d".
+void drawCrypto(RGBmatrixPanel4 &matrix, const String &name, double price, double priceDiff);
+
+#endif
@@ -0,0 +1,158 @@
+/*
+Animation player for RGBmatrixPanel4, see RGBmatrixAnimation.h.  Frames
+are streamed from a file into the back buffer as they're due, so
+playback never holds up loop().
+
+BSD license, all text above must be included in any redistribution.
+*/
+
+#include "RGBmatrixAnimation.h"
+
+#define HEADERSIZE 14
+
+RGBmatrixAnimation::RGBmatrixAnimation(RGBmatrixPanel4 &m)
+{
+	matrix = &m;
+	stream = NULL;
+	head   = tail = 0;
+	frames = frame = interval = 0;
+	due    = 0;
+}
+
+boolean RGBmatrixAnimation::begin(Stream &s)
+{
+	uint8_t h[HEADERSIZE], i;
+
+	stream = &s;
+	head   = tail = 0;
+	for(i = 0; i < HEADERSIZE; i++)
+	{
+		if(!fill())
+		{
+			stop();
+			return false;
+		}
+		h[i] = chunk[head++];
+	}
+	if(memcmp(h, "RMA1", 4) || (h[4] != RGBMATRIX_PLANES) ||
+	   (h[5] != RGBMATRIX_PLANEBYTES) || (h[6] != matrix->nRows) ||
+	   ((h[8] | (h[9] << 8)) != matrix->rowbytes))
+	{
+		stop();
+		return false;
+	}
+	frames   = h[10] | (h[11] << 8);
+	interval = h[12] | (h[13] << 8);
+	frame    = 0;
+	due      = millis();
+	return true;
+}
+
+boolean RGBmatrixAnimation::update(void)
+{
+	uint32_t now = millis(), rows = 0;
+
+	if(!stream) return false;
+	if((int32_t)(now - due) < 0) return true; // Not due yet
+	if(frame >= frames)                       // Last frame has had its time
+	{
+		stop();
+		return false;
+	}
+	if(matrix->swapPending()) return true;    // Double buffered, still queued
+
+	// Changes are relative to the frame before, or a blank screen
+	if(frame) matrix->syncBackBuffer();
+	else      matrix->fillScreen(0);
+	if(!decode(matrix->backBuffer(), &rows))
+	{
+		stop();
+		return false;
+	}
+	matrix->markDirty(rows);
+	matrix->requestSwap();
+	frame++;
+
+	// Keep to the frame rate, without rushing to catch up after a stall
+	due += interval;
+	if((int32_t)(now - due) >= 0) due = now + interval;
+	return true;
+}
+
+boolean RGBmatrixAnimation::playing(void)
+{
+	return stream != NULL;
+}
+
+void RGBmatrixAnimation::stop(void)
+{
+	stream = NULL;
+}
+
+// Top up the chunk once it's all been used.  False at the end of the
+// stream.
+boolean RGBmatrixAnimation::fill(void)
+{
+	if(head < tail) return true;
+	head = 0;
+	tail = stream->readBytes((char *)chunk, RGBMATRIX_ANIM_CHUNK);
+	return tail > 0;
+}
+
+boolean RGBmatrixAnimation::varint(uint32_t *v)
+{
+	uint8_t b, shift;
+
+	*v = 0;
+	for(shift = 0; shift < 32; shift += 7)
+	{
+		if(!fill()) return false;
+		b   = chunk[head++];
+		*v |= (uint32_t)(b & 0x7F) << shift;
+		if(!(b & 0x80)) return true;
+	}
+	return false;
+}
+
+// Apply one frame's changes to buf, flagging the multiplexed rows stored
+// into.  False if the frame is cut short or runs off the buffer.
+boolean RGBmatrixAnimation::decode(uint8_t *buf, uint32_t *rows)
+{
+	uint32_t pos = 0, size = (uint32_t)matrix->nRows * matrix->rowbytes;
+	uint32_t v, n, k, r;
+
+	for(;;)
+	{
+		if(!varint(&v)) return false; // Stream ended mid frame
+		if(!v)          return true;  // End of frame
+		n = v >> 1;
+		if(pos + n > size) return false;
+		if(v & 1)
+		{
+			for(r = pos / matrix->rowbytes; r <= (pos + n - 1) / matrix->rowbytes; r++)
+				*rows |= 1UL << r;
+			while(n)
+			{
+				// Once the chunk's used up, long runs go straight from the
+				// stream into the buffer
+				if((head == tail) && (n >= RGBMATRIX_ANIM_CHUNK))
+				{
+					if(stream->readBytes((char *)&buf[pos], n) != n) return false;
+					pos += n;
+					break;
+				}
+				if(!fill()) return false;
+				k = tail - head;
+				if(k > n) k = n;
+				memcpy(&buf[pos], &chunk[head], k);
+				head += k;
+				pos  += k;
+				n    -= k;
+			}
+		}
+		else
+		{
+			pos += n;
+		}
+	}
+}
@@ -0,0 +1,60 @@
+#ifndef _RGBMATRIXANIMATION_H_
+#define _RGBMATRIXANIMATION_H_
+
+#include "RGBmatrixPanel4.h"
+
+// Plays full screen animations made by extras/host/matrixanim.cpp, read a
+// chunk at a time from a Stream (an open SPIFFS File, say) straight into
+// the back buffer, so a file needn't fit in RAM.  Frames are stored as
+// the bytes that changed since the previous frame, in the frame buffer's
+// own layout; a file only plays on the display geometry and color depth
+// it was made for.
+//
+// File layout, numbers little endian:
+//
+//   "RMA1", planes, planebytes, rows (multiplexed), 0,
+//   16-bit rowbytes, 16-bit frames, 16-bit milliseconds per frame
+//
+// then per frame a list of varints (7 bits per byte, low first): n << 1
+// to skip n unchanged bytes, (n << 1) | 1 followed by n bytes to store,
+// 0 to end the frame.  The first frame is relative to a blank screen.
+
+#define RGBMATRIX_ANIM_CHUNK 64 // Bytes read from the stream at a time
+
+class RGBmatrixAnimation {
+
+ public:
+
+  RGBmatrixAnimation(RGBmatrixPanel4 &matrix);
+
+  // Start playing from the stream, which must stay open until the end.
+  // Returns false (and plays nothing) if it isn't an animation for this
+  // display.
+  boolean
+    begin(Stream &stream);
+  // Call from loop() instead of drawing, as often as convenient: when
+  // the next frame is due and there is a buffer to put it in, it's
+  // decoded and queued with requestSwap(); otherwise this returns at
+  // once.  Returns false once the last frame has had its time on screen
+  // (or the file turned out to be short or corrupt).
+  boolean
+    update(void);
+  boolean
+    playing(void);
+  void
+    stop(void);
+
+ private:
+
+  RGBmatrixPanel4 *matrix;
+  Stream          *stream;
+  uint8_t          chunk[RGBMATRIX_ANIM_CHUNK];
+  uint8_t          head, tail;  // Unread bytes are chunk[head..tail-1]
+  uint16_t         frames, frame, interval;
+  uint32_t         due;         // millis() the next frame is shown at
+  boolean          fill(void);
+  boolean          varint(uint32_t *v);
+  boolean          decode(uint8_t *buf, uint32_t *rows);
+};
+
+#endif // _RGBMATRIXANIMATION_H_
@@ -0,0 +1,208 @@
+/*
+Pin sequence generator and decoder for RGBmatrixPanel4, see
+RGBmatrixBitstream.h.  Deliberately free of any Arduino or ESP-IDF
+dependencies so it can be built and checked off-target.
+
+BSD license, all text above must be included in any redistribution.
+*/
+
+#include "RGBmatrixBitstream.h"
+#include <string.h>
+#include <stdlib.h>
+
+RGBmatrixBitstream::RGBmatrixBitstream(void)
+{
+	// Default assignment, also used by RGBmatrixPanel4::beginDMA()
+	for(uint8_t i = 0; i < 6; i++) rgbbit[i] = i;
+	clkbit = 6;
+	latbit = 7;
+	oebit  = 8;
+	for(uint8_t i = 0; i < 4; i++) addrbit[i] = 9 + i;
+	naddr      = 2;
+	nrows      = 4;
+	nplanes    = 4;
+	planebytes = 4;
+	stride     = 64;
+	overruns   = 0;
+	memset(duration, 0, sizeof(duration));
+	memset(blank, 0, sizeof(blank));
+}
+
+uint16_t RGBmatrixBitstream::expand(uint8_t b) const
+{
+	uint16_t s = 0;
+
+	for(uint8_t i = 0; i < 6; i++)
+	{
+		if(b & (4 << i)) s |= 1 << rgbbit[i];
+	}
+	return s;
+}
+
+// Pin states left behind by the final interrupt of a refresh cycle, which
+// is where the first interrupt of the (circular) sequence starts from:
+// output enabled, latch and clock low, last row addressed and the data
+// lines holding the last byte clocked out.
+uint16_t RGBmatrixBitstream::endState(const uint8_t *frame) const
+{
+	uint16_t state = 0;
+	uint8_t  last  = nrows - 1;
+
+	for(uint8_t i = 0; i < naddr; i++)
+	{
+		if(last & (1 << i)) state |= 1 << addrbit[i];
+	}
+	// Last plane of the last row, whose data immediately precedes the
+	// next row's plane bytes in either layout
+	state |= expand(frame[(uint32_t)nrows * planebytes * stride - 1]);
+	return state;
+}
+
+// Follows updateDisplay() one register write at a time.  Each interrupt:
+// disable output, latch the data loaded last time, update the address
+// lines when plane 1 comes up (plane 0 of the new row is about to be
+// latched), enable output and release the latch, then clock out the next
+// plane -- clear data and clock, set data, set clock, once per byte, and
+// finally clock low.  Each interrupt is followed by the display interval
+// of the plane loaded by the *prior* interrupt.  With 'blank' set, output
+// is forced off for the last samples of the interval, whatever the
+// interrupt is doing by then (the dimmed display, see setBrightness()).
+size_t RGBmatrixBitstream::generate(const uint8_t *frame, uint16_t *out,
+    size_t max)
+{
+	const uint16_t oe  = 1 << oebit,
+	               lat = 1 << latbit,
+	               clk = 1 << clkbit;
+	uint16_t       rgbclk = clk, state = endState(frame);
+	size_t         n = 0, start, blankat;
+	const uint8_t *ptr;
+	uint8_t        row, plane, shown, i;
+	uint16_t       j;
+
+	#define emit(s) do { state = (s);                             \
+	                     if(n >= blankat)     { state |= oe; }    \
+	                     if(out && (n < max)) { out[n] = state; } \
+	                     n++; } while(0)
+
+	for(i = 0; i < 6; i++) rgbclk |= 1 << rgbbit[i];
+	overruns = 0;
+
+	for(row = 0; row < nrows; row++)
+	{
+		for(plane = 0; plane < nplanes; plane++)
+		{
+			start = n;
+			shown = plane ? (plane - 1) : (nplanes - 1);
+			blankat = (size_t)-1;
+
+			emit(state | oe);
+			emit(state | lat);
+			if(plane == 1)
+			{
+				for(i = 0; i < naddr; i++)
+				{
+					if(row & (1 << i)) emit(state |  (1 << addrbit[i]));
+					else               emit(state & ~(1 << addrbit[i]));
+				}
+			}
+			if(duration[shown] && blank[shown])
+				blankat = start + duration[shown] - blank[shown];
+			emit(state & ~oe);
+			emit(state & ~lat);
+
+			if((plane > 0) || (planebytes == nplanes))
+			{
+				ptr = &frame[(uint32_t)row * planebytes * stride +
+				             (plane - (nplanes - planebytes)) * stride];
+				for(j = 0; j < stride; j++)
+				{
+					emit(state & ~rgbclk);
+					emit(state | expand(ptr[j]));
+					emit(state | clk);
+				}
+				emit(state & ~clk);
+			}
+
+			if(duration[shown])
+			{
+				if(n - start > duration[shown])
+					overruns++;
+				while(n - start < duration[shown]) emit(state);
+			}
+		}
+	}
+
+	#undef emit
+	return n;
+}
+
+// A panel chain is a long shift register per data line: each rising clock
+// edge shifts in one bit, a rising latch edge copies the register to the
+// LED drivers, and while output enable is low the latched bits light the
+// addressed row.  The interval between latch edges says which plane was
+// shown.  The stream is walked twice so the interval spanning the wrap-
+// around is complete; only intervals ending in the second pass count.
+void RGBmatrixBitstream::decode(const uint16_t *samples, size_t n,
+    uint8_t *frame) const
+{
+	const uint16_t oe  = 1 << oebit,
+	               lat = 1 << latbit,
+	               clk = 1 << clkbit;
+	uint8_t  *shift   = (uint8_t *)calloc(stride, 1),
+	         *latched = (uint8_t *)calloc(stride, 1),
+	          b, row = 0, q;
+	uint16_t  s, prev = samples[n - 1];
+	size_t    i, lastlatch = 0;
+	bool      lit = false, started = false;
+
+	memset(frame, 0, (uint32_t)nrows * nplanes * stride);
+
+	for(i = 0; i < 2 * n; i++)
+	{
+		s = samples[i % n];
+
+		if((s & clk) && !(prev & clk))
+		{
+			for(b = 0, q = 0; q < 6; q++)
+			{
+				if(s & (1 << rgbbit[q])) b |= 4 << q;
+			}
+			memmove(shift, shift + 1, stride - 1);
+			shift[stride - 1] = b;
+		}
+
+		if((s & lat) && !(prev & lat))
+		{
+			if(started && lit && (i >= n))
+			{
+				for(q = 0; q < nplanes; q++)
+				{
+					if(duration[q] == i - lastlatch)
+					{
+						memcpy(&frame[((uint32_t)row * nplanes + q) * stride],
+						  latched, stride);
+						break;
+					}
+				}
+			}
+			memcpy(latched, shift, stride);
+			lastlatch = i;
+			started   = true;
+			lit       = false;
+		}
+
+		if(!(s & oe))
+		{
+			for(row = 0, q = 0; q < naddr; q++)
+			{
+				if(s & (1 << addrbit[q])) row |= 1 << q;
+			}
+			lit = true;
+		}
+
+		prev = s;
+	}
+
+	free(shift);
+	free(latched);
+}
@@ -0,0 +1,72 @@
+#ifndef _RGBMATRIXBITSTREAM_H_
+#define _RGBMATRIXBITSTREAM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Platform independent model of the pin sequence that
+// RGBmatrixPanel4::updateDisplay() produces on ESP32, as a list of
+// samples: one 16-bit word of pin states per register write the ISR
+// makes, with the wait until the next interrupt expressed as repeats of
+// the last sample.  Played back at a fixed rate by DMA (see
+// RGBmatrixPanel4::beginDMA()), the panel sees the same waveform the ISR
+// would generate, without any CPU time spent per row.
+//
+// Nothing here touches hardware, so the generator and its decoder can be
+// built and checked on a desktop machine.
+
+class RGBmatrixBitstream {
+
+ public:
+
+  RGBmatrixBitstream(void);
+
+  // Sample bit used for each signal:
+  uint8_t
+    rgbbit[6],  // R1, G1, B1, R2, G2, B2
+    clkbit, latbit, oebit,
+    addrbit[4]; // A, B, C, D
+
+  uint8_t
+    naddr,      // Address lines written on a row change (2 to 4)
+    nrows,      // Multiplexed rows (row addresses)
+    nplanes,    // BCM bitplanes, RGBMATRIX_PLANES
+    planebytes; // Bytes per LED pair in the frame buffer, nplanes or 3
+  uint16_t
+    stride;     // Bytes per plane of a multiplexed row (= LED pairs)
+  uint32_t
+    duration[8], // Samples each plane is displayed for; 0 = no padding
+    blank[8];    // Samples at the end of those with the output disabled
+
+  // Generate one full refresh cycle from a frame buffer laid out as
+  // RGBmatrixPanel4's.  Returns the number of samples; only up to max are
+  // stored, so pass out = NULL to find the size first.  With plane 0
+  // packed (planebytes 3 of 4 planes) it is not output, same as the ESP32 interrupt handler.
+  size_t
+    generate(const uint8_t *frame, uint16_t *out, size_t max);
+
+  // Count of interrupts in the last generate() whose output didn't fit
+  // in their plane's duration (the DMA timing equivalent of an ISR
+  // overrunning its timer period).
+  uint16_t
+    overruns;
+
+  // Reverse of generate(): simulate a chain of panels fed the (padded,
+  // circular) sample stream and rebuild the frame from the LEDs that were
+  // lit, one byte per plane per LED pair (unpacked layout) in 'frame'
+  // (nrows * nplanes * stride bytes).  Planes are identified by the
+  // length of their display interval, so durations must be distinct.
+  void
+    decode(const uint16_t *samples, size_t n, uint8_t *frame) const;
+
+  // Map a frame buffer byte (R,G,B bits 2-7) to sample bits.
+  uint16_t
+    expand(uint8_t b) const;
+
+ private:
+
+  uint16_t
+    endState(const uint8_t *frame) const;
+};
+
+#endif // _RGBMATRIXBITSTREAM_H_
@@ -41,11 +41,26 @@ BSD license, all text above must be included in any redistribution.
 
 #include "RGBmatrixPanel4.h"
 #include "gamma.h"
+#include "glcdfont.c" // Adafruit_GFX's built-in font, see drawChar()
 
 #ifdef ARDUINO_ARCH_ESP32
 #include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "driver/timer.h"
+#include "driver/gpio.h"
+#include "driver/periph_ctrl.h"
+#include "xtensa/hal.h"
+#include "esp_heap_caps.h"
+#include "esp_intr_alloc.h"
+#include "soc/i2s_struct.h"
+#include "soc/gpio_sig_map.h"
+#if __has_include("esp32/rom/lldesc.h") // IDF 4 moved the ROM headers
+#include "esp32/rom/lldesc.h"
+#include "esp32/rom/gpio.h"
+#else
+#include "rom/lldesc.h"
+#include "rom/gpio.h"
+#endif
 #endif
 
 #ifndef _swap_int16_t
@@ -104,21 +119,46 @@ BSD license, all text above must be included in any redistribution.
 // singular Timer1 doesn't really take well to object orientation with
 // multiple RGBmatrixPanel4 instances.  The solution at present is to
 // allow instances, but only one is active at any given time, via its
-// begin() method.  The implementation is still incomplete in parts;
-// the prior active panel really should be gracefully disabled, and a
-// stop() method should perhaps be added...assuming multiple instances
-// are even an actual need.
+// begin() method (end() stops it).  ESP32 doesn't have this limitation:
+// each instance gets a timer of its own, whose interrupt is passed the
+// instance, so several chains can be refreshed at once.
+#if !defined(ARDUINO_ARCH_ESP32)
 static RGBmatrixPanel4 *activePanel = NULL;
+#else
+static RGBmatrixPanel4 *timerPanel[2][2]; // Holding each [group][timer]
+#endif
+
+#if RGBMATRIX_SHADOW
+static void buildSpread(void); // See packShadow()
+#endif
 
 // Code common to both the 16x32 and 32x32 constructors:
 void RGBmatrixPanel4::init(uint8_t rows, uint8_t a, uint8_t b, uint8_t c,
-                          uint8_t sclk, uint8_t latch, uint8_t oe, boolean dbuf, uint8_t pwidth
+                          uint8_t sclk, uint8_t latch, uint8_t oe, uint8_t dbuf, uint8_t pwidth
 #if defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_ARCH_ESP32)
   ,uint8_t *pinlist
 #endif
 )
 {
-	
+	pixelmap = NULL;	// Until allocated below
+	rowmap   = NULL;
+	matrixbuff[0] = matrixbuff[1] = matrixbuff[2] = NULL;
+	oeport   = NULL;	// end() does nothing if set up fails
+	glyphvalid = 0;
+#if RGBMATRIX_SHADOW
+	shadow   = packmap = NULL;
+	linerows = NULL;
+	shadowrows = shadowink = 0;
+#endif
+#if defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_ARCH_ESP32)
+	wordbuff[0] = NULL;
+#endif
+#if defined(ARDUINO_ARCH_ESP32)
+	dmamode  = false;
+	timintr  = NULL;
+	dmaintr  = NULL;
+#endif
+
 #if defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_ARCH_ESP32)
   // R1, G1, B1, R2, G2, B2 pins
 //  static const uint8_t defaultrgbpins[] = { 2,3,4,5,6,7 };
@@ -136,14 +176,64 @@ void RGBmatrixPanel4::init(uint8_t rows, uint8_t a, uint8_t b, uint8_t c,
 	rows = rows/nMultiplexRows;
 	nRows = rows; // Number of multiplexed rows; actual height is 4X for 1/4 scan
 	nPanels = pwidth;
+	tilecols   = pwidth; // One row of panels until setTiling()
+	tilerows   = 1;
+	serpentine = false;
 	
-	// Allocate and initialize matrix buffer:
-	int buffsize  = 32 * nMultiplexRows * nRows * 3 * nPanels , // x3 = 3 bytes holds 4 planes "packed"
-	    allocsize = (dbuf == true) ? (buffsize * 2) : buffsize;
+	// Allocate and initialize matrix buffer(s), dbuf being the number of
+	// buffers besides the one on display:
+#if defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_ARCH_ESP32)
+	expanded = (dbuf & RGBMATRIX_EXPANDED) != 0;
+#endif
+	dbuf &= ~RGBMATRIX_EXPANDED;
+	if(dbuf > RGBMATRIX_TRIPLEBUF) dbuf = RGBMATRIX_TRIPLEBUF;
+	nBuffers = 1 + dbuf;
+	int buffsize  = 32 * nMultiplexRows * nRows * RGBMATRIX_PLANEBYTES * nPanels , // 3 bytes hold 4 planes if packed, see header
+	    allocsize = buffsize * nBuffers;
+	// pixelmap has 15 bits for a buffer offset (see buildPixelMap()), which
+	// holds 32 16x32 panels at 4 planes, 16 at 8.  Longer chains or walls
+	// aren't set up at all, and begin() won't start them.
+	if(buffsize > 0x8000) return;
 	if(NULL == (matrixbuff[0] = (uint8_t *)malloc(allocsize))) return;
 	memset(matrixbuff[0], 0, allocsize);
-	// If not double-buffered, both buffers then point to the same address:
-	matrixbuff[1] = (dbuf == true) ? &matrixbuff[0][buffsize] : matrixbuff[0];
+	// Buffers not in use point to the last one allocated, so if not
+	// double-buffered, all buffers then point to the same address:
+	matrixbuff[1] = (nBuffers > 1) ? &matrixbuff[0][buffsize]     : matrixbuff[0];
+	matrixbuff[2] = (nBuffers > 2) ? &matrixbuff[0][buffsize * 2] : matrixbuff[1];
+	stride   = 32 * nMultiplexRows * nPanels;
+	rowbytes = RGBMATRIX_PLANEBYTES * stride;
+#if defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_ARCH_ESP32)
+	// Expanded copies always hold all planes, plane 0 unpacked if need be
+	// (filled by begin() once the expand[] table is known).  Without the
+	// RAM for them, fall back to the normal mode.
+	if(expanded)
+	{
+		int wordsize = 32 * nMultiplexRows * nRows * RGBMATRIX_PLANES * nPanels;
+		if(NULL == (wordbuff[0] = (PortType *)malloc(wordsize * nBuffers * sizeof(PortType))))
+			expanded = false;
+		wordbuff[1] = (nBuffers > 1) ? &wordbuff[0][wordsize]     : wordbuff[0];
+		wordbuff[2] = (nBuffers > 2) ? &wordbuff[0][wordsize * 2] : wordbuff[1];
+	}
+#endif
+
+	// Pixel address lookup table, one entry per pixel (see buildPixelMap()):
+	if(NULL == (pixelmap = (uint16_t *)malloc(WIDTH * HEIGHT * sizeof(uint16_t)))) return;
+
+	// Each multiplexed row (RGBMATRIX_PLANEBYTES of 'stride' bytes) is a multiple of
+	// 32 bytes, so the row a buffer offset belongs to is rowmap[offset >> 5]:
+	if(NULL == (rowmap = (uint8_t *)malloc(buffsize >> 5))) return;
+	for(int i = 0; i < (buffsize >> 5); i++) rowmap[i] = (i << 5) / rowbytes;
+	drawnrows = clearedrows = 0;
+	for(int i = 0; i < 3; i++) inkrows[i] = stalerows[i] = 0;
+
+#if RGBMATRIX_SHADOW
+	// Shadow, its map into the buffer and the rows each line of it lands
+	// in (lines being up to WIDTH pixels long when rotated)
+	if(NULL == (shadow   = (uint16_t *)calloc(WIDTH * HEIGHT, sizeof(uint16_t)))) return;
+	if(NULL == (packmap  = (uint16_t *)malloc(WIDTH * HEIGHT * sizeof(uint16_t)))) return;
+	if(NULL == (linerows = (uint32_t *)malloc(((WIDTH > HEIGHT) ? WIDTH : HEIGHT) * sizeof(uint32_t)))) return;
+	buildSpread();
+#endif
 
 	// Save pin numbers for use by begin() method later.
 	_a     = a;
@@ -166,17 +256,188 @@ void RGBmatrixPanel4::init(uint8_t rows, uint8_t a, uint8_t b, uint8_t c,
 	addrbpin  = digitalPinToBitMask(b);
 	addrcport = portOutputRegister(digitalPinToPort(c));
 	addrcpin  = digitalPinToBitMask(c);
-	nPlanes   = 4;     // Other code is fixed at 4 planes; don't change this
+	nPlanes   = RGBMATRIX_PLANES; // Buffer layout depends on it, see header
 	plane     = nPlanes - 1;
 	row       = nRows   - 1;
 	swapflag  = false;
 	backindex = 0;     // Array index of back buffer
+	swapcallback = NULL;
+	swaparg      = NULL;
+#if defined(ARDUINO_ARCH_ESP32)
+	swaptask     = NULL;
+	timgroup     = TIMER_GROUP_1;
+	timidx       = TIMER_0;
+	{
+		portMUX_TYPE unlocked = portMUX_INITIALIZER_UNLOCKED;
+		swapmux = unlocked;
+	}
+#endif
+	reqhz        = 0;
+	reqshare     = 0;
+	cpumhz       = 0;
+	brightness   = 255;
+	blanking     = false;
+	estimateTiming();
+	resetStats();
+	scanmap      = RGBmatrixScanSnake;
+	buildPixelMap();
+}
+
+// With fewer row addresses than physical rows per half, the buffer address
+// of a pixel is an awkward function of x and y: each multiplexed row holds
+// nMultiplexRows physical rows per half, chained as the scan map says
+// (the 1/4 scan 'snake' layout interleaves them in runs of 8 LEDs).
+// Rather than work that out for every drawPixel() call, it's done once
+// here for every pixel in the current rotation.  Each entry holds the
+// offset of the pixel's first plane byte, with bit 15 set if the pixel is
+// in the lower half of the display (data in the upper bits of each byte).
+// init() keeps offsets below 0x8000.
+void RGBmatrixPanel4::buildPixelMap(void)
+{
+	int16_t  x, y, nx, ny, mux, tx, ty, ph = HEIGHT / tilerows;
+	uint16_t half, *map = pixelmap;
+
+	if(map == NULL) return;
+#if RGBMATRIX_SHADOW
+	if((packmap == NULL) || (linerows == NULL)) return;
+#endif
+
+	for(y = 0; y < _height; y++)
+	{
+		for(x = 0; x < _width; x++)
+		{
+			nx = x;
+			ny = y;
+			switch(rotation)
+			{
+			case 1:
+				nx = WIDTH  - 1 - y;
+				ny = x;
+				break;
+			case 2:
+				nx = WIDTH  - 1 - x;
+				ny = HEIGHT - 1 - y;
+				break;
+			case 3:
+				nx = y;
+				ny = HEIGHT - 1 - x;
+				break;
+			}
+
+			// Tiled panels: find the panel and the pixel's place on it,
+			// then carry on as if that panel were in a single row.
+			tx  = nx / 32;
+			ty  = ny / ph;
+			nx %= 32;
+			ny %= ph;
+			if(serpentine && (ty & 1))
+			{
+				tx = tilecols - 1 - tx; // Row of panels runs back, upside down
+				nx = 31 - nx;
+				ny = ph - 1 - ny;
+			}
+			nx += (ty * tilecols + tx) * 32;
+
+			// Lower half pixels share bytes with the upper half, one row
+			// group down.  Then find the multiplexed row and which of the
+			// physical rows sharing it this is:
+			half = 0;
+			if(ny >= nRows * nMultiplexRows)
+			{
+				ny  -= nRows * nMultiplexRows;
+				half = 0x8000;
+			}
+			mux = ny / nRows;
+
+			*map++ = half | (
+			    (ny % nRows) * rowbytes +                   // Multiplexed row
+			    (nx / 32) * 32 * nMultiplexRows +           // Panel
+			    scanmap(nx & 31, mux, nMultiplexRows));     // LED within it
+		}
+	}
+
+#if RGBMATRIX_SHADOW
+	// Every LED pair has one pixel from each half, so packmap holds two
+	// entries per pair, upper then lower: pair p of multiplexed row r
+	// (plane 0 byte r * rowbytes + p) at 2 * (r * stride + p).
+	uint16_t m, off;
+	uint32_t rows;
+	for(y = 0, map = pixelmap; y < _height; y++)
+	{
+		for(x = 0, rows = 0; x < _width; x++, map++)
+		{
+			m   = *map;
+			off = m & 0x7FFF;
+			packmap[((off / rowbytes) * stride + off % rowbytes) * 2 + (m >> 15)] =
+			  y * _width + x;
+			rows |= 1UL << rowmap[off >> 5];
+		}
+		linerows[y] = rows;
+	}
+#endif
+}
+
+void RGBmatrixPanel4::setRotation(uint8_t r)
+{
+	Adafruit_GFX::setRotation(r);
+	buildPixelMap();
+}
+
+uint16_t RGBmatrixScanSnake(uint8_t x, uint8_t mux, uint8_t nmux)
+{
+	return (x / 8) * 8 * nmux + (nmux - 1 - mux) * 8 + (x & 7);
+}
+
+uint16_t RGBmatrixScanLinear(uint8_t x, uint8_t mux, uint8_t nmux)
+{
+	return (nmux - 1 - mux) * 32 + x;
+}
+
+// Only the pixel map changes: the chain and buffers are the same however
+// the panels are arranged.
+boolean RGBmatrixPanel4::setTiling(uint8_t cols, uint8_t rows, boolean serpentine)
+{
+	if(!cols || !rows || (cols * rows != nPanels)) return false;
+
+	HEIGHT           = HEIGHT / tilerows * rows;
+	WIDTH            = 32 * cols;
+	tilecols         = cols;
+	tilerows         = rows;
+	this->serpentine = serpentine;
+	setRotation(rotation); // Updates width(), height() and the map
+	return true;
+}
+
+// The buffers don't change size (every physical row still gets 32 LED
+// pairs per panel), just how they divide into multiplexed rows.  Contents
+// drawn under the old pattern aren't moved, hence before begin().
+boolean RGBmatrixPanel4::setScanPattern(uint8_t scan, RGBmatrixScanMap map)
+{
+	uint8_t half = HEIGHT / tilerows / 2; // Physical rows per half of a panel
+	int     i;
+
+	if((scan < 2) || (scan > 16) || (half % scan) || (map == NULL)) return false;
+
+	nRows          = scan;
+	nMultiplexRows = half / scan;
+	stride         = 32 * nMultiplexRows * nPanels;
+	rowbytes       = RGBMATRIX_PLANEBYTES * stride;
+	row            = nRows   - 1;
+	plane          = nPlanes - 1;
+	scanmap        = map;
+	if(rowmap)
+	{
+		for(i = 0; i < ((nRows * rowbytes) >> 5); i++) rowmap[i] = (i << 5) / rowbytes;
+	}
+	estimateTiming();
+	buildPixelMap();
+	return true;
 }
 
 // Constructor for 16x32 panel:
 RGBmatrixPanel4::RGBmatrixPanel4(
     uint8_t a, uint8_t b, uint8_t c,
-    uint8_t sclk, uint8_t latch, uint8_t oe, boolean dbuf, uint8_t pwidth
+    uint8_t sclk, uint8_t latch, uint8_t oe, uint8_t dbuf, uint8_t pwidth
 #if defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_ARCH_ESP32)
     ,uint8_t *pinlist
 #endif
@@ -193,7 +454,7 @@ RGBmatrixPanel4::RGBmatrixPanel4(
 // Constructor for 32x32 panel:
 RGBmatrixPanel4::RGBmatrixPanel4(
     uint8_t a, uint8_t b, uint8_t c, uint8_t d,
-    uint8_t sclk, uint8_t latch, uint8_t oe, boolean dbuf, uint8_t pwidth
+    uint8_t sclk, uint8_t latch, uint8_t oe, uint8_t dbuf, uint8_t pwidth
 #if defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_ARCH_ESP32)
     ,uint8_t *pinlist
 #endif
@@ -212,21 +473,59 @@ RGBmatrixPanel4::RGBmatrixPanel4(
 	addrdpin  = digitalPinToBitMask(d);
 }
 
+// Stop refreshing, then free what init() allocated (the DMA streams are
+// freed by end()):
+RGBmatrixPanel4::~RGBmatrixPanel4(void)
+{
+	end();
+	free(matrixbuff[0]);
+#if defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_ARCH_ESP32)
+	free(wordbuff[0]);
+#endif
+	free(pixelmap);
+	free(rowmap);
+#if RGBMATRIX_SHADOW
+	free(shadow);
+	free(packmap);
+	free(linerows);
+#endif
+}
+
 #if defined(ARDUINO_ARCH_SAMD)
 #define TIMER         TC4
 #define IRQN          TC4_IRQn
 #define IRQ_HANDLER   TC4_Handler
 #define TIMER_GCLK_ID TC4_GCLK_ID
-#elif defined(ARDUINO_ARCH_ESP32)
-IRAM_ATTR void IRQ_HANDLER(void *);
+#endif
+
+#if defined(ARDUINO_ARCH_ESP32)
+boolean RGBmatrixPanel4::begin(uint8_t group, uint8_t timer)
+{
+	if(timintr || dmamode) return false;     // Already running
+	timgroup = group ? TIMER_GROUP_1 : TIMER_GROUP_0;
+	timidx   = timer ? TIMER_1 : TIMER_0;
+	begin();
+	return timintr != NULL;
+}
 #endif
 
 void RGBmatrixPanel4::begin(void)
 {
+	if(pixelmap == NULL) return;             // Set up failed, see init()
+#if defined(ARDUINO_ARCH_ESP32)
+	if(timintr || dmamode) return;           // Already running
+	if(timerPanel[timgroup][timidx]) return; // Another instance's timer
+#endif
 
 	backindex   = 0;                         // Back buffer
-	buffptr     = matrixbuff[1 - backindex]; // -> front buffer
+	frontindex  = (nBuffers > 1) ? 1 : 0;    // Front buffer
+	lastindex   = frontindex;
+	spareindex  = 2;                         // Triple buffering only
+	buffptr     = matrixbuff[frontindex];    // -> front buffer
+	blanking    = false;                     // Start on a whole interval
+#if !defined(ARDUINO_ARCH_ESP32)
 	activePanel = this;                      // For interrupt hander
+#endif
 
 	// Enable all comm & address pins as outputs, set default states:
 
@@ -305,6 +604,15 @@ void RGBmatrixPanel4::begin(void)
     }
 #endif
 
+#if defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_ARCH_ESP32)
+	if(expanded)
+	{
+		for(uint8_t i = 0; i < nBuffers; i++) expandBuffer(i);
+		wordptr = wordbuff[frontindex];
+	}
+	selectShifter();
+#endif
+
 #if defined(ARDUINO_ARCH_ESP32)
     timer_config_t tim_config;
     tim_config.divider = 2; // Run Timer at 40 MHz
@@ -314,17 +622,23 @@ void RGBmatrixPanel4::begin(void)
     tim_config.auto_reload = true;
     tim_config.intr_type = TIMER_INTR_LEVEL;
 
-    timer_init(TIMER_GROUP_1, TIMER_0, &tim_config);
+    timer_group_t group = (timer_group_t)timgroup;
+    timer_idx_t   timer = (timer_idx_t)timidx;
+
+    timer_init(group, timer, &tim_config);
     /* Timer's counter will initially start from value below.
     	 Also, if auto_reload is set, this value will be automatically reload on alarm */
-    timer_set_counter_value(TIMER_GROUP_1, TIMER_0, 0x00000000ULL);
+    timer_set_counter_value(group, timer, 0x00000000ULL);
     /* Configure the alarm value and the interrupt on alarm. */
-    timer_set_alarm_value(TIMER_GROUP_1, TIMER_0, 10000);
-    timer_enable_intr(TIMER_GROUP_1, TIMER_0);
-    timer_isr_register(TIMER_GROUP_1, TIMER_0, IRQ_HANDLER,
-    		(void *) TIMER_0, ESP_INTR_FLAG_IRAM, NULL);
+    timer_set_alarm_value(group, timer, 10000);
+    timer_enable_intr(group, timer);
+    timer_isr_register(group, timer, timerHandler,
+    		(void *) this, ESP_INTR_FLAG_IRAM, (intr_handle_t *)&timintr);
+    timerPanel[timgroup][timidx] = this;
 
-    timer_start(TIMER_GROUP_1, TIMER_0);
+    calibrate(); // Measure the interrupt handler before it goes live
+
+    timer_start(group, timer);
 #endif
 
 #if defined(__AVR__)
@@ -424,6 +738,278 @@ void RGBmatrixPanel4::begin(void)
 
 }
 
+// Stop refreshing and blank the display.  Buffers and settings are kept,
+// so drawing can carry on and begin() (or beginDMA()) restart it later.
+void RGBmatrixPanel4::end(void)
+{
+#if defined(__AVR__)
+	if(activePanel == this)
+	{
+		TIMSK1 &= ~_BV(TOIE1); // Disable Timer1 interrupt
+		activePanel = NULL;
+	}
+#elif defined(ARDUINO_ARCH_SAMD)
+	if(activePanel == this)
+	{
+		NVIC_DisableIRQ(IRQN);
+		TIMER->COUNT16.INTENCLR.reg = TC_INTENCLR_OVF;
+		activePanel = NULL;
+	}
+#elif defined(ARDUINO_ARCH_ESP32)
+	if(dmamode)
+	{
+		I2S1.conf.tx_start  = 0;
+		I2S1.out_link.stop  = 1;
+		I2S1.int_ena.val    = 0;
+		esp_intr_free((intr_handle_t)dmaintr);
+		for(uint8_t s = 0; s < 2; s++)
+		{
+			heap_caps_free(dmabuff[s]);
+			heap_caps_free(dmadesc[s]);
+		}
+		// Hand the pins back from I2S1 to the GPIO registers
+		uint32_t pins[13];
+		dmaPins(pins);
+		for(uint8_t i = 0; i < 9 + bitstream.naddr; i++)
+			gpio_matrix_out(pins[i], SIG_GPIO_OUT_IDX, false, false);
+		dmamode = false;
+	}
+	else if(timintr)
+	{
+		timer_pause((timer_group_t)timgroup, (timer_idx_t)timidx);
+		timer_disable_intr((timer_group_t)timgroup, (timer_idx_t)timidx);
+		esp_intr_free((intr_handle_t)timintr);
+		timintr = NULL;
+		timerPanel[timgroup][timidx] = NULL;
+	}
+#endif
+	if(oeport) *oeport |= oepin; // Disable LED output
+	swapflag = false;        // Nothing will pick up a pending swap now
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+// DMA refresh: rather than a timer interrupt bit-banging the pins, the I2S1
+// peripheral in LCD (parallel output) mode plays a precomputed stream of
+// pin states from memory, looping over a chain of DMA descriptors.  The
+// stream holds exactly the pin writes updateDisplay() would make (see
+// RGBmatrixBitstream), with the BCM delays as repeated samples, so the
+// panels see the same waveform but no CPU time is spent refreshing.
+//
+// The cost is RAM: two streams of 2 bytes per sample, 15 plane-0 intervals
+// of (3 * stride + 7) samples per multiplexed row -- about 46K each for two
+// 1/4 scan panels.  A new frame's stream is generated by requestSwap() and
+// queued behind the playing one; it takes over at the end of a refresh
+// cycle, and the swap is reported (swapPending(), callbacks) once it has
+// been shown in full, after which the old stream can be refilled.  So
+// requestSwap() waits if called again before then, even triple buffered.
+// Single buffered, call requestSwap() to show what has been drawn.
+#define RGBMATRIX_DMA_MAXLEN 4092 // Bytes per descriptor (4095 max, word multiple)
+#define RGBMATRIX_DMA_CLKDIV 4    // Sample clock = 80 MHz / (2 * CLKDIV)
+
+boolean RGBmatrixPanel4::beginDMA(void)
+{
+	uint32_t  pins[13];
+	uint8_t   i, s, nsignals;
+	uint16_t  j;
+	uint32_t  bytes;
+	uint8_t  *p;
+	lldesc_t *d;
+
+	if(pixelmap == NULL) return false;       // Set up failed, see init()
+	if(timintr || dmamode) return false;     // Already running
+	backindex   = 0;                         // Back buffer
+	frontindex  = (nBuffers > 1) ? 1 : 0;    // Front buffer
+	lastindex   = frontindex;
+	spareindex  = 2;                         // Triple buffering only
+
+	dmaPins(pins);
+	getBitstream(&bitstream);
+	nsamples = bitstream.generate(matrixbuff[frontindex], NULL, 0);
+	ndesc    = (nsamples * 2 + RGBMATRIX_DMA_MAXLEN - 1) / RGBMATRIX_DMA_MAXLEN;
+
+	for(s = 0; s < 2; s++)
+	{
+		dmabuff[s] = (uint16_t *)heap_caps_malloc(nsamples * 2, MALLOC_CAP_DMA);
+		dmadesc[s] = heap_caps_malloc(ndesc * sizeof(lldesc_t), MALLOC_CAP_DMA);
+		if((dmabuff[s] == NULL) || (dmadesc[s] == NULL))
+		{
+			// Out of DMA capable memory: give back what was allocated
+			for(i = 0; i <= s; i++)
+			{
+				heap_caps_free(dmabuff[i]);
+				heap_caps_free(dmadesc[i]);
+				dmabuff[i] = NULL;
+				dmadesc[i] = NULL;
+			}
+			return false;
+		}
+
+		d     = (lldesc_t *)dmadesc[s];
+		p     = (uint8_t *)dmabuff[s];
+		bytes = nsamples * 2;
+		for(j = 0; j < ndesc; j++)
+		{
+			d[j].size   = d[j].length = (bytes > RGBMATRIX_DMA_MAXLEN) ?
+			                            RGBMATRIX_DMA_MAXLEN : bytes;
+			d[j].offset = 0;
+			d[j].sosf   = 0;
+			d[j].eof    = (j == ndesc - 1); // Interrupt once per refresh cycle
+			d[j].owner  = 1;
+			d[j].buf    = p;
+			d[j].qe.stqe_next = &d[(j + 1) % ndesc];
+			p          += d[j].length;
+			bytes      -= d[j].length;
+		}
+	}
+	dmafront = 1;
+	loadDMA(frontindex); // Fill stream 0 and make it loop on itself
+	dmafront = 0;
+	dmamode  = true;
+	if(expanded)       // The streams take the place of expanded buffers
+	{
+		free(wordbuff[0]);
+		wordbuff[0] = NULL;
+		expanded = false;
+	}
+
+	// Route the signals to the I2S1 parallel outputs, which in 16 bit mode
+	// are data out signals 8-23.  C isn't output if unused, just held low.
+	nsignals = 9 + bitstream.naddr;
+	for(i = 0; i < nsignals; i++)
+	{
+		PIN_FUNC_SELECT(GPIO_PIN_MUX_REG[pins[i]], PIN_FUNC_GPIO);
+		gpio_set_direction((gpio_num_t)pins[i], GPIO_MODE_OUTPUT);
+		gpio_matrix_out(pins[i], I2S1O_DATA_OUT8_IDX + i, false, false);
+	}
+	if(bitstream.naddr < 3)
+	{
+		pinMode(_c, OUTPUT);
+		digitalWrite(_c, LOW);
+	}
+
+	periph_module_enable(PERIPH_I2S1_MODULE);
+
+	I2S1.conf.tx_reset       = 1; I2S1.conf.tx_reset       = 0;
+	I2S1.conf.tx_fifo_reset  = 1; I2S1.conf.tx_fifo_reset  = 0;
+	I2S1.lc_conf.out_rst     = 1; I2S1.lc_conf.out_rst     = 0;
+	I2S1.lc_conf.ahbm_rst    = 1; I2S1.lc_conf.ahbm_rst    = 0;
+
+	I2S1.conf2.val                     = 0;
+	I2S1.conf2.lcd_en                  = 1; // Parallel output
+	I2S1.conf2.lcd_tx_wrx2_en          = 1;
+	I2S1.sample_rate_conf.val          = 0;
+	I2S1.sample_rate_conf.tx_bits_mod  = 16;
+	I2S1.sample_rate_conf.tx_bck_div_num = 2;
+	I2S1.clkm_conf.val                 = 0;
+	I2S1.clkm_conf.clka_en             = 0; // 80 MHz PLL_D2 clock
+	I2S1.clkm_conf.clkm_div_a          = 1;
+	I2S1.clkm_conf.clkm_div_b          = 0;
+	I2S1.clkm_conf.clkm_div_num        = RGBMATRIX_DMA_CLKDIV;
+	I2S1.fifo_conf.val                 = 0;
+	I2S1.fifo_conf.tx_fifo_mod_force_en = 1;
+	I2S1.fifo_conf.tx_fifo_mod         = 1; // 16 bit single channel
+	I2S1.fifo_conf.tx_data_num         = 32;
+	I2S1.fifo_conf.dscr_en             = 1; // Fed by DMA
+	I2S1.conf1.val                     = 0;
+	I2S1.conf1.tx_stop_en              = 0;
+	I2S1.conf1.tx_pcm_bypass           = 1;
+	I2S1.conf_chan.val                 = 0;
+	I2S1.conf_chan.tx_chan_mod         = 1;
+	I2S1.conf.tx_right_first           = 1;
+	I2S1.timing.val                    = 0;
+	I2S1.lc_conf.val                   = 0;
+	I2S1.lc_conf.out_eof_mode          = 1;
+
+	I2S1.int_clr.val        = 0xFFFFFFFF;
+	I2S1.int_ena.val        = 0;
+	I2S1.int_ena.out_eof    = 1;
+	esp_intr_alloc(ETS_I2S1_INTR_SOURCE, ESP_INTR_FLAG_IRAM, dmaHandler,
+	  this, (intr_handle_t *)&dmaintr);
+
+	I2S1.out_link.addr  = (uint32_t)(uintptr_t)dmadesc[0];
+	I2S1.out_link.start = 1;
+	I2S1.conf.tx_start  = 1;
+	return true;
+}
+
+// The pins in the order of the stream's sample bits, see getBitstream().
+void RGBmatrixPanel4::dmaPins(uint32_t *pins)
+{
+	const uint32_t order[13] = { rgbpins[0], rgbpins[1], rgbpins[2],
+	                             rgbpins[3], rgbpins[4], rgbpins[5],
+	                             _sclk, _latch, _oe, _a, _b, _c, _d };
+
+	memcpy(pins, order, sizeof(order));
+}
+
+void RGBmatrixPanel4::getBitstream(RGBmatrixBitstream *b)
+{
+	uint16_t base, lit;
+
+	// Sample bits are assigned R1,G1,B1,R2,G2,B2,CLK,LAT,OE,A,B,C,D (the
+	// RGBmatrixBitstream default), address lines as used by updateDisplay().
+	b->naddr      = (nRows > 8) ? 4 : (nRows > 4) ? 3 : 2;
+	b->nrows      = nRows;
+	b->nplanes    = nPlanes;
+	b->planebytes = RGBMATRIX_PLANEBYTES;
+	b->stride     = stride;
+	// Plane 0 is shown for as long as the busiest interrupt takes to run
+	// (rounded up to whole 32-bit FIFO words), each later plane for twice
+	// as long as the one before, same as the timer durations.
+	base = (4 + b->naddr + 3 * stride + 1 + 1) & ~1;
+	for(uint8_t i = 0; i < nPlanes; i++) b->duration[i] = (uint32_t)base << i;
+	// Dimmed, each plane is lit for a share of plane 0's time doubled, so
+	// the planes keep their weights.
+	lit = ((uint32_t)base * brightness + 127) / 255;
+	for(uint8_t i = 0; i < nPlanes; i++)
+		b->blank[i] = (uint32_t)(base - lit) << i;
+}
+
+// Generate the stream for a buffer into the idle stream and queue it to
+// follow the one playing.  The idle stream must not be queued already.
+void RGBmatrixPanel4::loadDMA(uint8_t buf)
+{
+	uint8_t   next = 1 - dmafront;
+	lldesc_t *cur  = (lldesc_t *)dmadesc[dmafront],
+	         *nxt  = (lldesc_t *)dmadesc[next];
+	uint16_t *out  = dmabuff[next], t;
+	uint32_t  i;
+
+	bitstream.generate(matrixbuff[buf], out, nsamples);
+	// The FIFO sends the second sample of each 32-bit word first
+	for(i = 0; i < nsamples; i += 2)
+	{
+		t          = out[i];
+		out[i]     = out[i + 1];
+		out[i + 1] = t;
+	}
+	nxt[ndesc - 1].qe.stqe_next = nxt; // New stream loops on itself...
+	cur[ndesc - 1].qe.stqe_next = nxt; // ...once the current one ends
+}
+
+// End of descriptor chain interrupt, once per refresh cycle.  When the
+// queued stream has been played through it is the one looping, so the
+// old chain is closed back on itself, free for the next frame.
+IRAM_ATTR void RGBmatrixPanel4::dmaHandler(void *arg)
+{
+	RGBmatrixPanel4 *panel = (RGBmatrixPanel4 *)arg;
+	uint8_t          next  = 1 - panel->dmafront;
+	lldesc_t        *cur   = (lldesc_t *)panel->dmadesc[panel->dmafront],
+	                *nxt   = (lldesc_t *)panel->dmadesc[next];
+
+	if(I2S1.int_st.out_eof) panel->statframes++;
+	if(I2S1.int_st.out_eof &&
+	   (I2S1.out_eof_des_addr == (uint32_t)(uintptr_t)&nxt[panel->ndesc - 1]))
+	{
+		cur[panel->ndesc - 1].qe.stqe_next = cur;
+		panel->dmafront = next;
+		panel->endFrame();
+	}
+	I2S1.int_clr.val = I2S1.int_st.val;
+}
+#endif
+
+
 // Original RGBmatrixPanel4 library used 3/3/3 color.  Later version used
 // 4/4/4.  Then Adafruit_GFX (core library used across all Adafruit
 // display devices now) standardized on 5/6/5.  The matrix still operates
@@ -550,202 +1136,1135 @@ uint16_t RGBmatrixPanel4::ColorHSV(
 	       ((b & 0x7) <<  1) | ( b        >> 3);
 }
 
-void RGBmatrixPanel4::drawPixel(int16_t x, int16_t y, uint16_t c)
+#if !RGBMATRIX_PACKED
+
+// Bits kept in every plane byte when writing a pixel, for the upper and
+// lower halves of the display: each byte holds one pixel from each half.
+static const uint8_t packmask[2][1] = {
+	{ B11100011 },  // Upper half
+	{ B00011111 }   // Lower half
+};
+
+// Adafruit_GFX uses 16-bit color in 5/6/5 format, while matrix needs
+// RGBMATRIX_PLANES bits per channel, one byte per plane, R,G,B in bits 2-4
+// for the upper half of the display or bits 5-7 for the lower.  Channels
+// are widened to 8 bits (so 5 bits of red still reach full scale at
+// depths above 5) and the top bits taken.  Work out the bits to OR into
+// each byte:
+static inline void packColor(uint16_t c, boolean lower, uint8_t *v)
 {
-	uint8_t r, g, b, bit, limit, *ptr;
-	uint16_t shift;
+	uint8_t r, g, b, k, shift = lower ? 5 : 2;
 
-	if((x < 0) || (x >= _width) || (y < 0) || (y >= _height)) return;
+	r =  c >> 11;         // RRRRRggggggbbbbb
+	g = (c >>  5) & 0x3F; // rrrrrGGGGGGbbbbb
+	b =  c        & 0x1F; // rrrrrggggggBBBBB
+	r = ((r << 3) | (r >> 2)) >> (8 - RGBMATRIX_PLANES);
+	g = ((g << 2) | (g >> 4)) >> (8 - RGBMATRIX_PLANES);
+	b = ((b << 3) | (b >> 2)) >> (8 - RGBMATRIX_PLANES);
 
-	int xtemp;
-	//if (nCounter < 16) written=false;
-	
+	for(k = 0; k < RGBMATRIX_PLANES; k++)
+		v[k] = (((r >> k) & 1) | (((g >> k) & 1) << 1) | (((b >> k) & 1) << 2)) << shift;
+}
 
-	switch(rotation)
-	{
-	case 1:
-		_swap_int16_t(x, y);
-		x = WIDTH  - 1 - x;
-		break;
-	case 2:
-		x = WIDTH  - 1 - x;
-		y = HEIGHT - 1 - y;
-		break;
-	case 3:
-		_swap_int16_t(x, y);
-		y = HEIGHT - 1 - y;
-		break;
-	}
+// Store one pixel's color bits, ptr being its plane 0 byte.
+static inline void putPixel(uint8_t *ptr, uint16_t stride,
+    const uint8_t *mask, const uint8_t *v)
+{
+	for(uint8_t k = 0; k < RGBMATRIX_PLANES; k++, ptr += stride)
+		*ptr = (*ptr & mask[0]) | v[k];
+}
+
+#else
+
+// Bits kept in each of the three packed plane bytes when writing a pixel,
+// for the upper and lower halves of the display.  The two sets are each
+// other's complement, as every byte holds one pixel from each half.
+static const uint8_t packmask[2][3] = {
+	{ B11100011, B11100010, B11100000 },  // Upper half
+	{ B00011100, B00011101, B00011111 }   // Lower half
+};
+
+// Adafruit_GFX uses 16-bit color in 5/6/5 format, while matrix needs
+// 4/4/4, spread over three bytes (one per plane 1-3, plane 0 using the
+// least 2 bits of all three).  Work out the bits to OR into each byte:
+static inline void packColor(uint16_t c, boolean lower, uint8_t *v)
+{
+	uint8_t r, g, b, p1, p2, p3;
 
-	// Adafruit_GFX uses 16-bit color in 5/6/5 format, while matrix needs
-	// 4/4/4.  Pluck out relevant bits while separating into R,G,B:
 	r =  c >> 12;        // RRRRrggggggbbbbb
 	g = (c >>  7) & 0xF; // rrrrrGGGGggbbbbb
 	b = (c >>  1) & 0xF; // rrrrrggggggBBBBb
 
-	// Loop counter stuff
-	bit   = 2;
-	limit = 1 << nPlanes;
-	
-	// Alternative layout of 1/4 panel:
-	// Calculate shift (distance between base of 
-	shift = 0;
-	if (x>7) shift+=8;
-	if (x>15) shift+=8;
-	if (x>23) shift+=8;
-	if (x>31) shift+=8;
-	if (x>39) shift+=8;
-	if (x>47) shift+=8;
-	if (x>55) shift+=8;
-	if (y < 4 || (y > 7 && y < 12))  
-	{ 
-		shift +=8; // top rows start after lower 8 leds
-	}
-
-	if (y==1 || y==5 || y==9 || y==13) shift += 32 * 3 * nPanels * nMultiplexRows; // row 1
-	if (y==2 || y==6 || y==10 || y==14) shift += 64 * 3 * nPanels * nMultiplexRows; // row 2
-	if (y==3 || y==7 || y==11 || y==15) shift += 96 * 3 * nPanels * nMultiplexRows; // row 3
-
-	ptr = &matrixbuff[backindex][shift+x]; // Base addr
-	
-	if(y < (nRows * nMultiplexRows))
+	// Planes 1-3 as 3-bit B,G,R values
+	p1 = ((r >> 1) & 1) | ( g       & 2) | ((b << 1) & 4);
+	p2 = ((r >> 2) & 1) | ((g >> 1) & 2) | ( b       & 4);
+	p3 = ((r >> 3) & 1) | ((g >> 2) & 2) | ((b >> 1) & 4);
+
+	if(lower)
 	{
-		// Data for the upper half of the display is stored in the lower
-		// bits of each byte.
-		
-		// Each base address has it's planes stored in 3 bytes, 32*nMultiplexRows*nPanels bytes apart (1 byte for 2 pixels: top/bottom). For 1/4 scan with 1 panel at relative addresses 0,64 and 128
-		// Plane 0 is a tricky case -- its data is spread about, stored in least two bits not used by the other planes.
-		ptr = ptr + (64 * nMultiplexRows * nPanels);		
-		*ptr &= ~B00000011;            // Plane 0 R,G mask out in one op
-		if(r & 1) *ptr |=  B00000001;  // Plane 0 R: 64 bytes ahead, bit 0
-		if(g & 1) *ptr |=  B00000010;  // Plane 0 G: 64 bytes ahead, bit 1
-
-		ptr = ptr - (32 * nMultiplexRows * nPanels);
-		if(b & 1) *ptr |=  B00000001;  // Plane 0 B: 32 bytes ahead, bit 0
-		else      *ptr &= ~B00000001;  // Plane 0 B unset; mask out
-		
-		// The remaining three image planes are more normal-ish.
-		// Data is stored in the high 6 bits so it can be quickly
-		// copied to the DATAPORT register w/6 output lines.
-		ptr = ptr - (32 * nMultiplexRows * nPanels);
-		
-		for(; bit < limit; bit <<= 1)
-		{
-			*ptr &= ~B00011100;             // Mask out R,G,B in one op
-			if(r & bit) *ptr |= B00000100;  // Plane N R: bit 2
-			if(g & bit) *ptr |= B00001000;  // Plane N G: bit 3
-			if(b & bit) *ptr |= B00010000;  // Plane N B: bit 4
-			ptr  += 32 * nMultiplexRows * nPanels;                  // Advance to next bit plane
-		}
-		// planeCounter = 0;
-		// Serial.println();
-		
+		// Data for the lower half of the display is stored in the upper
+		// bits; plane 0 G,B in the first byte, plane 0 R in the second.
+		v[0] = (p1 << 5) | (g & 1) | ((b & 1) << 1);
+		v[1] = (p2 << 5) | ((r & 1) << 1);
+		v[2] = (p3 << 5);
 	}
 	else
 	{
-		// Data for the lower half of the display is stored in the upper
-		// bits, except for the plane 0 stuff, using 2 least bits.
-		*ptr &= ~B00000011;               // Plane 0 G,B mask out in one op
-		if(r & 1)  ptr[32 * nMultiplexRows  * nPanels] |=  B00000010; // Plane 0 R: 32 bytes ahead, bit 1
-		else       ptr[32 * nMultiplexRows  * nPanels] &= ~B00000010; // Plane 0 R unset; mask out
-		if(g & 1) *ptr     |=  B00000001; // Plane 0 G: bit 0
-		if(b & 1) *ptr     |=  B00000010; // Plane 0 B: bit 0
-		for(; bit < limit; bit <<= 1)
-		{
-			*ptr &= ~B11100000;             // Mask out R,G,B in one op
-			if(r & bit) *ptr |= B00100000;  // Plane N R: bit 5
-			if(g & bit) *ptr |= B01000000;  // Plane N G: bit 6
-			if(b & bit) *ptr |= B10000000;  // Plane N B: bit 7
-			ptr  += 32 * nMultiplexRows * nPanels;                  // Advance to next bit plane
-		}
+		// Data for the upper half of the display is stored in the lower
+		// bits; plane 0 B in the second byte, plane 0 R,G in the third.
+		v[0] = (p1 << 2);
+		v[1] = (p2 << 2) | (b & 1);
+		v[2] = (p3 << 2) | (r & 1) | ((g & 1) << 1);
 	}
-	
 }
 
-void RGBmatrixPanel4::fillScreen(uint16_t c)
+// Store one pixel's packed color bits, ptr being its plane 1 byte.
+static inline void putPixel(uint8_t *ptr, uint16_t stride,
+    const uint8_t *mask, const uint8_t *v)
 {
-	if((c == 0x0000) || (c == 0xffff))
-	{
-		// For black or white, all bits in frame buffer will be identically
-		// set or unset (regardless of weird bit packing), so it's OK to just
-		// quickly memset the whole thing:
-		memset(matrixbuff[backindex], c, 32 * nMultiplexRows * nRows * 3 * nPanels);
-	}
-	else
+	ptr[0]          = (ptr[0]          & mask[0]) | v[0];
+	ptr[stride]     = (ptr[stride]     & mask[1]) | v[1];
+	ptr[stride * 2] = (ptr[stride * 2] & mask[2]) | v[2];
+}
+
+#endif // RGBMATRIX_PACKED
+
+#if RGBMATRIX_SHADOW
+
+// packShadow() works on whole LED pairs: all of a pair's plane bytes as
+// one integer, plane k in byte k.  A channel's bits are spread out to bit
+// 0 of each of those bytes by table (5 and 6 bit channels, reduced to the
+// display's depth as packColor() does), so a pixel's planes are three
+// lookups and the pair's two more shifts.
+#if RGBMATRIX_PLANES > 4
+typedef uint64_t spread_t;
+#else
+typedef uint32_t spread_t;
+#endif
+
+static spread_t spread5[32], spread6[64];
+
+static void buildSpread(void)
+{
+	uint8_t  i, k, v5, v6;
+
+	for(i = 0; i < 64; i++)
 	{
-		// Otherwise, need to handle it the long way:
-		Adafruit_GFX::fillScreen(c);
+		v5 = ((i << 3) | (i >> 2)) >> (8 - RGBMATRIX_PLANES);
+		v6 = ((i << 2) | (i >> 4)) >> (8 - RGBMATRIX_PLANES);
+		if(i < 32) spread5[i] = 0;
+		spread6[i] = 0;
+		for(k = 0; k < RGBMATRIX_PLANES; k++)
+		{
+			if(i < 32) spread5[i] |= (spread_t)((v5 >> k) & 1) << (k * 8);
+			spread6[i] |= (spread_t)((v6 >> k) & 1) << (k * 8);
+		}
 	}
 }
 
-// Return address of back buffer -- can then load/store data directly
-uint8_t *RGBmatrixPanel4::backBuffer()
+// A color's R,G,B bits in bits 0-2 of each plane's byte
+static inline spread_t spreadColor(uint16_t c)
 {
-	return matrixbuff[backindex];
+	return  spread5[c >> 11]            |
+	       (spread6[(c >> 5) & 0x3F] << 1) |
+	       (spread5[c & 0x1F]        << 2);
 }
 
+// Four LED pairs' plane bytes (a to d, plane k in byte k) rearranged to
+// one word per plane, out[k] holding byte k of a, b, c and d in turn.
+static inline void transpose4(uint32_t a, uint32_t b, uint32_t c, uint32_t d,
+    uint32_t *out)
+{
+	uint32_t ab02 = ( a       & 0x00FF00FF) | ((b & 0x00FF00FF) << 8),
+	         ab13 = ((a >> 8) & 0x00FF00FF) |  (b & 0xFF00FF00),
+	         cd02 = ( c       & 0x00FF00FF) | ((d & 0x00FF00FF) << 8),
+	         cd13 = ((c >> 8) & 0x00FF00FF) |  (d & 0xFF00FF00);
+
+	out[0] = (ab02 & 0x0000FFFF) | (cd02 << 16);
+	out[1] = (ab13 & 0x0000FFFF) | (cd13 << 16);
+	out[2] = (ab02 >> 16)        | (cd02 & 0xFFFF0000);
+	out[3] = (ab13 >> 16)        | (cd13 & 0xFFFF0000);
+}
 
-// For smooth animation -- drawing always takes place in the "back" buffer;
-// this method pushes it to the "front" for display.  Passing "true", the
-// updated display contents are then copied to the new back buffer and can
-// be incrementally modified.  If "false", the back buffer then contains
-// the old front buffer contents -- your code can either clear this or
-// draw over every pixel.  (No effect if double-buffering is not enabled.)
-void RGBmatrixPanel4::swapBuffers(boolean copy)
+// Bring the back buffer up to date with the shadow: multiplexed rows it
+// has changed in, and rows where the buffer is behind the latest frame
+// (which the shadow drew too).  Packing goes in buffer order, four LED
+// pairs at a time, so every plane byte is written whole, as part of a
+// 32-bit store, and never read (little endian, as ESP32 and SAMD are).
+void RGBmatrixPanel4::packShadow(void)
 {
-	if(matrixbuff[0] != matrixbuff[1])
+	const uint16_t *map, *pix = shadow;
+	uint8_t        *buf = matrixbuff[backindex], *dst, i, k, n;
+	uint16_t        p, u, l, lastu = 0, lastl = 0;
+	uint32_t        rows = shadowrows | stalerows[backindex], w[8];
+	spread_t        v[4], upper = 0, lower = 0;
+
+	if(!rows) return;
+	for(i = 0; i < nRows; i++)
 	{
-		// To avoid 'tearing' display, actual swap takes place in the interrupt
-		// handler, at the end of a complete screen refresh cycle.
-		swapflag = true;                  // Set flag here, then...
-		while(swapflag == true) delay(1); // wait for interrupt to clear it
-		if(copy == true)
-			memcpy(matrixbuff[backindex], matrixbuff[1 - backindex], 32 * nRows * nMultiplexRows * 3 * nPanels);
+		if(!(rows & (1UL << i))) continue;
+		dst = &buf[i * rowbytes];
+		map = &packmap[i * stride * 2];
+		for(p = 0; p < stride; p += 4, map += 8)
+		{
+			// Neighbouring pixels are mostly the same color, so the last
+			// one spread out is kept for each half
+			for(n = 0; n < 4; n++)
+			{
+				u = pix[map[n * 2]];
+				l = pix[map[n * 2 + 1]];
+				if(u != lastu)
+				{
+					upper = spreadColor(u) << 2;
+					lastu = u;
+				}
+				if(l != lastl)
+				{
+					lower = spreadColor(l) << 5;
+					lastl = l;
+				}
+				v[n] = upper | lower;
+			}
+			transpose4(v[0], v[1], v[2], v[3], &w[0]);
+#if RGBMATRIX_PLANES > 4
+			transpose4(v[0] >> 32, v[1] >> 32, v[2] >> 32, v[3] >> 32, &w[4]);
+#endif
+			for(k = 0; k < RGBMATRIX_PLANES; k++)
+				*(uint32_t *)&dst[k * stride + p] = w[k];
+		}
 	}
+	drawnrows           |= rows;
+	stalerows[backindex] = 0;
+	shadowrows           = 0;
 }
 
-// Dump display contents to the Serial Monitor, adding some formatting to
-// simplify copy-and-paste of data as a PROGMEM-embedded image for another
-// sketch.  If using multiple dumps this way, you'll need to edit the
-// output to change the 'img' name for each.  Data can then be loaded
-// back into the display using a pgm_read_byte() loop.
-void RGBmatrixPanel4::dumpMatrix(void) {
-
-  int i, buffsize = WIDTH * nRows * 3;
+#endif // RGBMATRIX_SHADOW
 
-  Serial.print(F("\n\n"
-    "#include <avr/pgmspace.h>\n\n"
-    "static const uint8_t PROGMEM img[] = {\n  "));
+void RGBmatrixPanel4::drawPixel(int16_t x, int16_t y, uint16_t c)
+{
+	if((x < 0) || (x >= _width) || (y < 0) || (y >= _height)) return;
 
-  for(i=0; i<buffsize; i++) {
-    Serial.print(F("0x"));
-    if(matrixbuff[backindex][i] < 0x10) Serial.write('0');
-    Serial.print(matrixbuff[backindex][i],HEX);
-    if(i < (buffsize - 1)) {
-      if((i & 7) == 7) Serial.print(F(",\n  "));
-      else             Serial.write(',');
-    }
-  }
-  Serial.println(F("\n};"));
+#if RGBMATRIX_SHADOW
+	shadow[y * _width + x] = c;
+	shadowrows |= linerows[y];
+	shadowink  |= linerows[y];
+#else
+	uint8_t  v[RGBMATRIX_PLANEBYTES];
+	uint16_t m;
+
+	// Rotation and the 1/4 scan snake layout are already resolved in the
+	// pixel map, leaving just a lookup and a masked store per plane byte.
+	m = pixelmap[y * _width + x];
+	packColor(c, m >> 15, v);
+	putPixel(&matrixbuff[backindex][m & 0x7FFF], stride, packmask[m >> 15], v);
+	drawnrows |= 1UL << rowmap[(m & 0x7FFF) >> 5];
+#endif
 }
 
-// -------------------- Interrupt handler stuff --------------------
-/*
-ISR(TIMER1_OVF_vect, ISR_BLOCK)   // ISR_BLOCK important -- see notes later
+// Adafruit_GFX would draw lines and rectangles one drawPixel() at a time,
+// converting the color and checking bounds for every pixel.  Here the
+// rectangle is clipped once and the color packed once for each half, so
+// each pixel is just a map lookup and a masked store per plane byte.
+void RGBmatrixPanel4::fillArea(int16_t x, int16_t y, int16_t w, int16_t h,
+    uint16_t c)
 {
-	activePanel->updateDisplay();   // Call refresh func for active display
-	TIFR1 |= TOV1;                  // Clear Timer1 interrupt flag
-}
-*/
+	uint16_t *row;
+	uint32_t  rows = 0;
+	int16_t   i;
+
+	if(w < 0) { x += w + 1; w = -w; }
+	if(h < 0) { y += h + 1; h = -h; }
+	if(x < 0) { w += x; x = 0; }
+	if(y < 0) { h += y; y = 0; }
+	if(x + w > _width)  w = _width  - x;
+	if(y + h > _height) h = _height - y;
+	if((w <= 0) || (h <= 0)) return;
+
+#if RGBMATRIX_SHADOW
+	for(row = &shadow[y * _width + x]; h > 0; h--, y++, row += _width)
+	{
+		for(i = 0; i < w; i++) row[i] = c;
+		rows |= linerows[y];
+	}
+	shadowrows |= rows;
+	shadowink  |= rows;
+#else
+	uint8_t  v[2][RGBMATRIX_PLANEBYTES], *buf = matrixbuff[backindex];
+	uint16_t m;
 
-#if defined(__AVR__)
+	packColor(c, false, v[0]);
+	packColor(c, true,  v[1]);
 
-ISR(TIMER1_OVF_vect, ISR_BLOCK) { // ISR_BLOCK important -- see notes later
-  activePanel->updateDisplay();   // Call refresh func for active display
-  TIFR1 |= TOV1;                  // Clear Timer1 interrupt flag
+	for(row = &pixelmap[y * _width + x]; h > 0; h--, row += _width)
+	{
+		for(i = 0; i < w; i++)
+		{
+			m = row[i];
+			putPixel(&buf[m & 0x7FFF], stride, packmask[m >> 15], v[m >> 15]);
+			rows |= 1UL << rowmap[(m & 0x7FFF) >> 5];
+		}
+	}
+	drawnrows |= rows;
+#endif
 }
 
-#elif defined(ARDUINO_ARCH_SAMD)
+void RGBmatrixPanel4::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t c)
+{
+	fillArea(x, y, w, 1, c);
+}
+
+void RGBmatrixPanel4::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t c)
+{
+	fillArea(x, y, 1, h, c);
+}
+
+void RGBmatrixPanel4::fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+    uint16_t c)
+{
+	fillArea(x, y, w, h, c);
+}
+
+void RGBmatrixPanel4::writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+    uint16_t c)
+{
+	fillArea(x, y, w, h, c);
+}
+
+void RGBmatrixPanel4::fillScreen(uint16_t c)
+{
+#if RGBMATRIX_SHADOW
+	// Only rows that may hold something need packing again to clear
+	if(c == 0x0000)
+	{
+		memset(shadow, 0, WIDTH * HEIGHT * sizeof(uint16_t));
+		shadowrows |= shadowink;
+		shadowink   = 0;
+	}
+	else
+	{
+		// Doubling the filled part each time, so it's mostly memcpy()
+		uint16_t n, total = WIDTH * HEIGHT;
+		shadow[0] = c;
+		for(n = 1; n < total; n *= 2)
+			memcpy(&shadow[n], shadow, ((n < total - n) ? n : total - n) * sizeof(uint16_t));
+		shadowrows = shadowink = 0xFFFFFFFF;
+	}
+#else
+	uint8_t  upper[RGBMATRIX_PLANEBYTES], lower[RGBMATRIX_PLANEBYTES];
+	uint8_t  *ptr = matrixbuff[backindex];
+	uint8_t  i, k;
+	uint32_t rows;
+
+	if(c == 0x0000)
+	{
+		// Clearing only needs to touch rows that have been drawn into since
+		// this buffer was last cleared -- on a mostly static screen that
+		// can be a small fraction of the buffer.
+		rows = inkrows[backindex] | drawnrows;
+		for(i = 0; i < nRows; i++, ptr += rowbytes)
+		{
+			if(rows & (1UL << i)) memset(ptr, 0, rowbytes);
+		}
+		inkrows[backindex] = 0;
+	}
+	else
+	{
+		// With every pixel the same color, each plane byte holds the same
+		// value throughout the buffer: the upper and lower half bits ORed
+		// together.  So the buffer is just runs of repeating bytes, one run
+		// per plane of each multiplexed row, and memset does word-wide
+		// stores.
+		packColor(c, false, upper);
+		packColor(c, true,  lower);
+		for(i = 0; i < nRows; i++)
+		{
+			for(k = 0; k < RGBMATRIX_PLANEBYTES; k++, ptr += stride)
+				memset(ptr, upper[k] | lower[k], stride);
+		}
+		rows = inkrows[backindex] = 0xFFFFFFFF;
+	}
+	clearedrows |= rows;
+	drawnrows    = 0;
+#endif
+}
+
+// How blitArea() reads the bitmap:
+#define RGBMATRIX_BLIT_PROGMEM 1 // From flash (pgm_read_word())
+#define RGBMATRIX_BLIT_444     2 // 0x0RGB rather than 5/6/5
+#define RGBMATRIX_BLIT_KEYED   4 // Skip pixels equal to the key
+
+// Bitmaps are clipped once, as in fillArea(), then copied a row at a
+// time.  Images mostly come in runs of one color (icons especially), so
+// the last color packed for each half of the display is kept, and only
+// a change of color costs a packColor().
+void RGBmatrixPanel4::blitArea(int16_t x, int16_t y, const uint16_t *bitmap,
+    int16_t w, int16_t h, uint8_t flags, uint16_t key)
+{
+	uint16_t        c, *row;
+	const uint16_t *src;
+	uint32_t        rows = 0;
+	int16_t         i, i0 = 0, i1 = w, j, j0 = 0, j1 = h;
+
+	if(x < 0) i0 = -x;
+	if(y < 0) j0 = -y;
+	if(x + w > _width)  i1 = _width  - x;
+	if(y + h > _height) j1 = _height - y;
+	if((i0 >= i1) || (j0 >= j1)) return;
+
+#if RGBMATRIX_SHADOW
+	for(j = j0; j < j1; j++)
+	{
+		src = &bitmap[j * w];
+		row = &shadow[(y + j) * _width + x];
+		if(!flags)
+		{
+			memcpy(&row[i0], &src[i0], (i1 - i0) * sizeof(uint16_t));
+		}
+		else
+		{
+			for(i = i0; i < i1; i++)
+			{
+				c = (flags & RGBMATRIX_BLIT_PROGMEM) ? pgm_read_word(&src[i]) : src[i];
+				if((flags & RGBMATRIX_BLIT_KEYED) && (c == key)) continue;
+				if(flags & RGBMATRIX_BLIT_444) c = Color444(c >> 8, c >> 4, c);
+				row[i] = c;
+			}
+		}
+		rows |= linerows[y + j];
+	}
+	shadowrows |= rows;
+	shadowink  |= rows;
+#else
+	uint8_t  v[2][RGBMATRIX_PLANEBYTES], half, *buf = matrixbuff[backindex];
+	uint16_t m, last[2];
+	boolean  packed[2] = { false, false };
+
+	for(j = j0; j < j1; j++)
+	{
+		src = &bitmap[j * w];
+		row = &pixelmap[(y + j) * _width + x];
+		for(i = i0; i < i1; i++)
+		{
+			c = (flags & RGBMATRIX_BLIT_PROGMEM) ? pgm_read_word(&src[i]) : src[i];
+			if((flags & RGBMATRIX_BLIT_KEYED) && (c == key)) continue;
+			if(flags & RGBMATRIX_BLIT_444) c = Color444(c >> 8, c >> 4, c);
+			m    = row[i];
+			half = m >> 15;
+			if(!packed[half] || (c != last[half]))
+			{
+				packColor(c, half, v[half]);
+				last[half]   = c;
+				packed[half] = true;
+			}
+			putPixel(&buf[m & 0x7FFF], stride, packmask[half], v[half]);
+			rows |= 1UL << rowmap[(m & 0x7FFF) >> 5];
+		}
+	}
+	drawnrows |= rows;
+#endif
+}
+
+void RGBmatrixPanel4::drawRGBBitmap(int16_t x, int16_t y,
+    const uint16_t bitmap[], int16_t w, int16_t h)
+{
+	blitArea(x, y, bitmap, w, h, RGBMATRIX_BLIT_PROGMEM, 0);
+}
+
+void RGBmatrixPanel4::drawRGBBitmap(int16_t x, int16_t y,
+    uint16_t *bitmap, int16_t w, int16_t h)
+{
+	blitArea(x, y, bitmap, w, h, 0, 0);
+}
+
+void RGBmatrixPanel4::drawRGBBitmap(int16_t x, int16_t y,
+    const uint16_t bitmap[], int16_t w, int16_t h, uint16_t key)
+{
+	blitArea(x, y, bitmap, w, h,
+	  RGBMATRIX_BLIT_PROGMEM | RGBMATRIX_BLIT_KEYED, key);
+}
+
+void RGBmatrixPanel4::drawRGBBitmap(int16_t x, int16_t y,
+    uint16_t *bitmap, int16_t w, int16_t h, uint16_t key)
+{
+	blitArea(x, y, bitmap, w, h, RGBMATRIX_BLIT_KEYED, key);
+}
+
+void RGBmatrixPanel4::drawRGB444Bitmap(int16_t x, int16_t y,
+    const uint16_t bitmap[], int16_t w, int16_t h)
+{
+	blitArea(x, y, bitmap, w, h,
+	  RGBMATRIX_BLIT_PROGMEM | RGBMATRIX_BLIT_444, 0);
+}
+
+void RGBmatrixPanel4::drawRGB444Bitmap(int16_t x, int16_t y,
+    const uint16_t bitmap[], int16_t w, int16_t h, uint16_t key)
+{
+	blitArea(x, y, bitmap, w, h,
+	  RGBMATRIX_BLIT_PROGMEM | RGBMATRIX_BLIT_444 | RGBMATRIX_BLIT_KEYED, key);
+}
+
+// Decode an atlas image straight into the back buffer.  Runs carry on
+// across rows; each is cut at the end of its row, at the display's
+// edges, and its color packed only once for each half it lands in.
+void RGBmatrixPanel4::drawImage(const RGBmatrixAtlas *atlas, uint8_t index,
+    int16_t x, int16_t y)
+{
+	uint8_t        run;
+	const uint8_t *src;
+	uint16_t       c = 0, *row;
+	uint32_t       rows = 0;
+	int16_t        w, h, i = 0, j = 0, n, k, k0, k1;
+#if !RGBMATRIX_SHADOW
+	uint8_t        v[2][RGBMATRIX_PLANEBYTES], half, packed;
+	uint8_t       *buf = matrixbuff[backindex];
+	uint16_t       m;
+#endif
+
+	if(index >= atlas->count) return;
+	w   = pgm_read_byte(&atlas->entries[index].width);
+	h   = pgm_read_byte(&atlas->entries[index].height);
+	src = &atlas->data[pgm_read_dword(&atlas->entries[index].offset)];
+	if(!w || (x >= _width) || (y >= _height) || (x + w <= 0) || (y + h <= 0))
+		return;
+
+	while(j < h)
+	{
+		run    = pgm_read_byte(src++);
+		n      = (run & 0x7F) + 1;
+#if !RGBMATRIX_SHADOW
+		packed = 0;
+#endif
+		if(run & 0x80) c = pgm_read_word(&atlas->palette[pgm_read_byte(src++)]);
+		while(n > 0)
+		{
+			// The part of the run in this row, and of that on the display
+			k1 = (i + n > w) ? w : i + n;
+			if((run & 0x80) && (y + j >= 0) && (y + j < _height))
+			{
+				k0  = (x + i < 0) ? -x : i;
+#if RGBMATRIX_SHADOW
+				row = &shadow[(y + j) * _width];
+				for(k = k0; (k < k1) && (x + k < _width); k++) row[x + k] = c;
+				rows |= linerows[y + j];
+#else
+				row = &pixelmap[(y + j) * _width];
+				for(k = k0; (k < k1) && (x + k < _width); k++)
+				{
+					m    = row[x + k];
+					half = m >> 15;
+					if(!(packed & (1 << half)))
+					{
+						packColor(c, half, v[half]);
+						packed |= 1 << half;
+					}
+					putPixel(&buf[m & 0x7FFF], stride, packmask[half], v[half]);
+					rows |= 1UL << rowmap[(m & 0x7FFF) >> 5];
+				}
+#endif
+			}
+			n -= k1 - i;
+			i  = k1;
+			if(i == w)
+			{
+				i = 0;
+				if(++j >= h) break;
+			}
+		}
+	}
+#if RGBMATRIX_SHADOW
+	shadowrows |= rows;
+	shadowink  |= rows;
+#else
+	drawnrows |= rows;
+#endif
+}
+
+// Plane bytes of a text color, for the upper [0] and lower [1] halves of
+// the display.  A screen's text rarely uses more than a few colors, so
+// they're kept in a small direct-mapped cache rather than packed again
+// for every character.
+const uint8_t (*RGBmatrixPanel4::textColor(uint16_t c))[RGBMATRIX_PLANEBYTES]
+{
+	uint8_t i = (c ^ (c >> 5) ^ (c >> 11)) & 3;
+
+	if(!(glyphvalid & (1 << i)) || (glyphkey[i] != c))
+	{
+		packColor(c, false, glyphcolor[i][0]);
+		packColor(c, true,  glyphcolor[i][1]);
+		glyphkey[i]  = c;
+		glyphvalid  |= 1 << i;
+	}
+	return glyphcolor[i];
+}
+
+// Same as Adafruit_GFX::drawChar() for the built-in 5x7 font at size 1,
+// but with both colors packed up front (see textColor()), so each pixel
+// of the 6x8 cell is a map lookup and a masked store per plane byte.
+// A character straddling an edge is clipped to the columns and rows on
+// the display first, rather than pixel by pixel.
+void RGBmatrixPanel4::drawChar(int16_t x, int16_t y, unsigned char c,
+    uint16_t color, uint16_t bg, uint8_t size_x, uint8_t size_y)
+{
+	uint8_t        line, i, i0, i1, j, j0, j1;
+	uint16_t      *map;
+	uint32_t       rows = 0;
+	boolean        opaque = (bg != color);
+
+	if(gfxFont || (size_x != 1) || (size_y != 1))
+	{
+		Adafruit_GFX::drawChar(x, y, c, color, bg, size_x, size_y);
+		return;
+	}
+	if((x >= _width) || (y >= _height) || (x + 5 < 0) || (y + 7 < 0)) return;
+	if(!_cp437 && (c >= 176)) c++; // Handle 'classic' charset behavior
+
+	// Columns and rows of the cell on the display
+	i0 = (x < 0) ? -x : 0;
+	i1 = (x + 6 > _width) ? _width - x : 6;
+	j0 = (y < 0) ? -y : 0;
+	j1 = (y + 8 > _height) ? _height - y : 8;
+
+#if RGBMATRIX_SHADOW
+	for(i = i0; i < i1; i++)
+	{
+		line = (i < 5) ? pgm_read_byte(&font[c * 5 + i]) >> j0 : 0;
+		if(!opaque && !line) continue;
+		map = &shadow[(y + j0) * _width + x + i];
+		for(j = j0; j < j1; j++, line >>= 1, map += _width)
+		{
+			if(line & 1)     *map = color;
+			else if(opaque)  *map = bg;
+		}
+	}
+	for(j = j0; j < j1; j++) rows |= linerows[y + j];
+	shadowrows |= rows;
+	shadowink  |= rows;
+#else
+	uint8_t        fg[2][RGBMATRIX_PLANEBYTES], bk[2][RGBMATRIX_PLANEBYTES];
+	uint8_t       *buf = matrixbuff[backindex];
+	const uint8_t (*v)[RGBMATRIX_PLANEBYTES];
+	uint16_t       m;
+
+	// Copied out, as looking up bg could evict color from the cache
+	memcpy(fg, textColor(color), sizeof(fg));
+	if(opaque) memcpy(bk, textColor(bg), sizeof(bk));
+
+	for(i = i0; i < i1; i++)
+	{
+		// Column 5 is the gap to the next character, background only
+		line = (i < 5) ? pgm_read_byte(&font[c * 5 + i]) >> j0 : 0;
+		if(!opaque && !line) continue;
+		map = &pixelmap[(y + j0) * _width + x + i];
+		for(j = j0; j < j1; j++, line >>= 1, map += _width)
+		{
+			if(line & 1)     v = fg;
+			else if(opaque)  v = bk;
+			else             continue;
+			m = *map;
+			putPixel(&buf[m & 0x7FFF], stride, packmask[m >> 15], v[m >> 15]);
+			rows |= 1UL << rowmap[(m & 0x7FFF) >> 5];
+		}
+	}
+	drawnrows |= rows;
+#endif
+}
+
+size_t RGBmatrixPanel4::write(uint8_t c)
+{
+	return write(&c, 1);
+}
+
+// Adafruit_GFX::write() with the classic font, just so the drawChar() it
+// calls is the one above (drawChar() isn't virtual).  Whole strings come
+// through here (print(), printf()), and characters entirely off the
+// display only move the cursor, so a long banner mostly off screen costs
+// little more than its visible part.
+size_t RGBmatrixPanel4::write(const uint8_t *buffer, size_t size)
+{
+	int16_t w = textsize_x * 6, h = textsize_y * 8;
+	size_t  n;
+
+	if(gfxFont)
+	{
+		for(n = 0; n < size; n++) Adafruit_GFX::write(buffer[n]);
+		return size;
+	}
+
+	for(n = 0; n < size; n++)
+	{
+		if(buffer[n] == '\n')
+		{
+			cursor_x  = 0;
+			cursor_y += h;
+		}
+		else if(buffer[n] != '\r')
+		{
+			if(wrap && ((cursor_x + w) > _width))
+			{
+				cursor_x  = 0;
+				cursor_y += h;
+			}
+			if((cursor_x < _width) && (cursor_x + w > 0) &&
+			   (cursor_y < _height) && (cursor_y + h > 0))
+				drawChar(cursor_x, cursor_y, buffer[n], textcolor, textbgcolor,
+				  textsize_x, textsize_y);
+			cursor_x += w;
+		}
+	}
+	return size;
+}
+
+// Each frame of a scrolling banner: copy the visible window of the strip,
+// pixel by pixel as drawChar() does (colors packed once), reading the
+// strip's bits straight from its buffer.  When transparent, only columns
+// the strip covers are visited and blank bytes of it are skipped whole.
+void RGBmatrixPanel4::drawScroll(const GFXcanvas1 *strip, int16_t y,
+    int16_t offset, uint16_t color, uint16_t bg)
+{
+	uint8_t        bits;
+	const uint8_t *src;
+	uint16_t      *map;
+	uint32_t       rows = 0;
+	int16_t        pitch = (strip->width() + 7) / 8, j, j1, x, x0, x1, sx, n;
+	boolean        opaque = (bg != color);
+
+	// Rows of the strip on screen
+	j  = (y < 0) ? -y : 0;
+	j1 = strip->height();
+	if(y + j1 > _height) j1 = _height - y;
+	// Columns to visit; all of them if the background is drawn
+	x0 = 0;
+	x1 = _width;
+	if(!opaque)
+	{
+		if(offset < 0)                     x0 = -offset;
+		if(strip->width() - offset < x1)   x1 = strip->width() - offset;
+	}
+
+	// Transparent, only set bits are visited.  SCROLLBITS loads the rest
+	// of the strip byte at column sx, its first bit in bit 7 and cut off
+	// at column x1, and n the columns that covers; stepping through the
+	// bits counts n down to the columns left after the last set one.
+	#define SCROLLBITS                              \
+	  n    = 8 - (sx & 7);                          \
+	  bits = src[sx >> 3] << (sx & 7);              \
+	  if(n > x1 - x)                                \
+	  {                                             \
+	    n     = x1 - x;                             \
+	    bits &= 0xFF << (8 - n);                    \
+	  }
+
+#if RGBMATRIX_SHADOW
+	for(; j < j1; j++)
+	{
+		src = &strip->getBuffer()[j * pitch];
+		map = &shadow[(y + j) * _width];
+		if(opaque)
+		{
+			for(x = x0; x < x1; x++)
+			{
+				sx     = x + offset;
+				bits   = ((sx >= 0) && (sx < strip->width())) ? src[sx >> 3] : 0;
+				map[x] = (bits & (0x80 >> (sx & 7))) ? color : bg;
+			}
+		}
+		else
+		{
+			for(x = x0, sx = x0 + offset; x < x1; x += n, sx += n)
+			{
+				SCROLLBITS
+				for(; bits; bits <<= 1, x++, sx++, n--)
+				{
+					if(bits & 0x80) map[x] = color;
+				}
+			}
+		}
+		rows |= linerows[y + j];
+	}
+	shadowrows |= rows;
+	shadowink  |= rows;
+#else
+	uint8_t        fg[2][RGBMATRIX_PLANEBYTES], bk[2][RGBMATRIX_PLANEBYTES];
+	uint8_t       *buf = matrixbuff[backindex];
+	const uint8_t (*v)[RGBMATRIX_PLANEBYTES];
+	uint16_t       m;
+
+	memcpy(fg, textColor(color), sizeof(fg));
+	if(opaque) memcpy(bk, textColor(bg), sizeof(bk));
+
+	for(; j < j1; j++)
+	{
+		src = &strip->getBuffer()[j * pitch];
+		map = &pixelmap[(y + j) * _width];
+		if(opaque)
+		{
+			for(x = x0; x < x1; x++)
+			{
+				sx   = x + offset;
+				bits = ((sx >= 0) && (sx < strip->width())) ? src[sx >> 3] : 0;
+				v    = (bits & (0x80 >> (sx & 7))) ? fg : bk;
+				m    = map[x];
+				putPixel(&buf[m & 0x7FFF], stride, packmask[m >> 15], v[m >> 15]);
+				rows |= 1UL << rowmap[(m & 0x7FFF) >> 5];
+			}
+		}
+		else
+		{
+			for(x = x0, sx = x0 + offset; x < x1; x += n, sx += n)
+			{
+				SCROLLBITS
+				for(; bits; bits <<= 1, x++, sx++, n--)
+				{
+					if(!(bits & 0x80)) continue;
+					m = map[x];
+					putPixel(&buf[m & 0x7FFF], stride, packmask[m >> 15], fg[m >> 15]);
+					rows |= 1UL << rowmap[(m & 0x7FFF) >> 5];
+				}
+			}
+		}
+	}
+	drawnrows |= rows;
+#endif
+	#undef SCROLLBITS
+}
+
+// Return address of back buffer -- can then load/store data directly.
+// Use markDirty() afterwards if relying on dirtyRows() or swap copies.
+uint8_t *RGBmatrixPanel4::backBuffer()
+{
+#if RGBMATRIX_SHADOW
+	packShadow();
+#endif
+	return matrixbuff[backindex];
+}
+
+// Reverse of packColor(): gather the pixel's bit from each plane, then
+// widen each channel back to 5/6/5 by repeating its bits.
+uint16_t RGBmatrixPanel4::getPixel(int16_t x, int16_t y, const uint8_t *frame)
+{
+	const uint8_t *ptr;
+	uint16_t       m, off;
+	uint8_t        shift, k, v, r = 0, g = 0, b = 0, r8 = 0, g8 = 0, b8 = 0;
+	int8_t         s;
+
+	if((x < 0) || (x >= _width) || (y < 0) || (y >= _height)) return 0;
+
+	m     = pixelmap[y * _width + x];
+	off   = m & 0x7FFF;
+	shift = (m >> 15) ? 5 : 2;
+
+	if(frame)
+	{
+		// Offsets in the map are to the pixel's first plane byte, in the
+		// buffer's layout; convert to the one byte per plane layout.
+		ptr = &frame[(off / rowbytes) * nPlanes * stride + (off % rowbytes)];
+		for(k = 0; k < nPlanes; k++, ptr += stride)
+		{
+			v  = *ptr >> shift;
+			r |= ( v       & 1) << k;
+			g |= ((v >> 1) & 1) << k;
+			b |= ((v >> 2) & 1) << k;
+		}
+	}
+	else
+	{
+#if RGBMATRIX_SHADOW
+		packShadow();
+#endif
+		ptr = &matrixbuff[backindex][off];
+#if RGBMATRIX_PACKED
+		// Planes 1-3 as for a frame; plane 0 is in the two low bits of
+		// each byte, see packColor().
+		for(k = 1; k < 4; k++, ptr += stride)
+		{
+			v  = *ptr >> shift;
+			r |= ( v       & 1) << k;
+			g |= ((v >> 1) & 1) << k;
+			b |= ((v >> 2) & 1) << k;
+		}
+		ptr = &matrixbuff[backindex][off];
+		if(shift == 5)
+		{
+			g |=  ptr[0]            & 1;
+			b |= (ptr[0]      >> 1) & 1;
+			r |= (ptr[stride] >> 1) & 1;
+		}
+		else
+		{
+			b |=  ptr[stride]            & 1;
+			r |=  ptr[stride * 2]        & 1;
+			g |= (ptr[stride * 2] >> 1) & 1;
+		}
+#else
+		for(k = 0; k < nPlanes; k++, ptr += stride)
+		{
+			v  = *ptr >> shift;
+			r |= ( v       & 1) << k;
+			g |= ((v >> 1) & 1) << k;
+			b |= ((v >> 2) & 1) << k;
+		}
+#endif
+	}
+
+	for(s = 8 - nPlanes; s > -nPlanes; s -= nPlanes)
+	{
+		r8 |= (s >= 0) ? (r << s) : (r >> -s);
+		g8 |= (s >= 0) ? (g << s) : (g >> -s);
+		b8 |= (s >= 0) ? (b << s) : (b >> -s);
+	}
+	return ((r8 & 0xF8) << 8) | ((g8 & 0xFC) << 3) | (b8 >> 3);
+}
+
+// Multiplexed rows (bit 0 = row 0) of the back buffer that differ from the
+// frame most recently queued for display, i.e. the rows a swap would
+// actually change.  Rows drawn into are compared against that frame, so
+// redrawing identical content (clearing and reprinting an unchanged clock,
+// say) doesn't count.  Returns 0 when a swap can be skipped.
+uint32_t RGBmatrixPanel4::dirtyRows(void)
+{
+	uint32_t rows;
+	uint8_t  i;
+
+#if RGBMATRIX_SHADOW
+	packShadow();
+#endif
+	rows = drawnrows | clearedrows | stalerows[backindex];
+
+	if((nBuffers > 1) && (lastindex != backindex))
+	{
+		for(i = 0; i < nRows; i++)
+		{
+			if((rows & (1UL << i)) &&
+			   !memcmp(&matrixbuff[backindex][i * rowbytes],
+			           &matrixbuff[lastindex][i * rowbytes], rowbytes))
+				rows &= ~(1UL << i);
+		}
+	}
+	return rows & ((nRows < 32) ? ((1UL << nRows) - 1) : 0xFFFFFFFF);
+}
+
+// Flag rows changed by writing through backBuffer() directly.
+void RGBmatrixPanel4::markDirty(uint32_t rows)
+{
+	drawnrows |= rows;
+#if RGBMATRIX_SHADOW
+	shadowink |= rows; // Not in the shadow, so cleared by repacking
+#endif
+}
+
+
+// For smooth animation -- drawing always takes place in the "back" buffer;
+// this method pushes it to the "front" for display.  Passing "true", the
+// updated display contents are then copied to the new back buffer and can
+// be incrementally modified.  If "false", the back buffer then contains
+// the old front buffer contents -- your code can either clear this or
+// draw over every pixel.  (No effect if double-buffering is not enabled.)
+// When double buffered this waits for the swap to happen; see
+// requestSwap() for an alternative.
+// Copying only covers rows where the new back buffer is out of date.
+void RGBmatrixPanel4::swapBuffers(boolean copy)
+{
+	if(nBuffers > 1)
+	{
+		requestSwap();                 // Set flag here, then...
+		while(swapPending()) delay(1); // wait for interrupt to clear it
+		if(copy == true) syncBackBuffer();
+	}
+}
+
+// The frame last queued is only read, so this is safe whether or not the
+// interrupt has picked it up yet.  Double buffered, there's nothing to do
+// until the swap lands (the back buffer *is* that frame).
+void RGBmatrixPanel4::syncBackBuffer(void)
+{
+	uint32_t rows = stalerows[backindex];
+	uint8_t  i;
+
+	if(lastindex == backindex) return;
+	for(i = 0; i < nRows; i++)
+	{
+		if(rows & (1UL << i))
+			memcpy(&matrixbuff[backindex][i * rowbytes],
+			       &matrixbuff[lastindex][i * rowbytes], rowbytes);
+	}
+	stalerows[backindex] = 0;
+	inkrows[backindex]   = inkrows[lastindex];
+}
+
+// Serializes buffer index changes between requestSwap() and the interrupt
+// handler.  On ESP32 this has to be a spinlock, as the two may be running
+// on different cores; elsewhere the handler can't be interrupted by the
+// app, so only the app side needs to hold off interrupts.
+#if defined(ARDUINO_ARCH_ESP32)
+// (swapmux is per instance, each having its own interrupt.)
+#define SWAP_LOCK()       portENTER_CRITICAL(&swapmux)
+#define SWAP_UNLOCK()     portEXIT_CRITICAL(&swapmux)
+#define SWAP_LOCK_ISR()   portENTER_CRITICAL_ISR(&swapmux)
+#define SWAP_UNLOCK_ISR() portEXIT_CRITICAL_ISR(&swapmux)
+#else
+#define SWAP_LOCK()       noInterrupts()
+#define SWAP_UNLOCK()     interrupts()
+#define SWAP_LOCK_ISR()
+#define SWAP_UNLOCK_ISR()
+#endif
+
+// Non-blocking half of swapBuffers().  To avoid 'tearing' display, the
+// actual swap takes place in the interrupt handler at the end of a
+// complete screen refresh cycle.
+//
+// Double buffered, the back buffer stays queued for display until then:
+// swapPending() is true and you mustn't draw into it, though other work
+// (network, input, etc.) can carry on in the meantime.
+//
+// Triple buffered, the finished frame is parked in the spare buffer and
+// the app immediately gets a free one to draw into: either the old front
+// buffer released by the interrupt, or a frame that was queued but never
+// shown because a newer one replaced it.  The interrupt always picks up
+// the most recently completed frame, and swapPending() is never true, so
+// rendering isn't tied to the refresh rate.
+//
+// The flag is handed between the app and the interrupt with acquire/
+// release ordering, as on ESP32 they may be running on different cores:
+// once swapPending() reads false, the new backindex is visible too.
+void RGBmatrixPanel4::requestSwap(void)
+{
+	uint8_t  i;
+	uint32_t rows;
+
+#if RGBMATRIX_SHADOW
+	packShadow();
+#endif
+	// Every other buffer now also differs from the latest frame wherever
+	// this one was changed (or was itself out of date).
+	rows = drawnrows | clearedrows | stalerows[backindex];
+	for(i = 0; i < nBuffers; i++) stalerows[i] |= rows;
+	stalerows[backindex] = 0;
+	inkrows[backindex]  |= drawnrows;
+	drawnrows = clearedrows = 0;
+	lastindex = backindex;
+	swaptime  = micros();
+
+#if defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_ARCH_ESP32)
+	if(expanded) expandBuffer(backindex);
+#endif
+#if defined(ARDUINO_ARCH_ESP32)
+	if(dmamode)
+	{
+		// Can only refill the idle stream once the last frame queued plays
+		while(__atomic_load_n(&swapflag, __ATOMIC_ACQUIRE)) delay(1);
+		loadDMA(backindex);
+		if(nBuffers == 1) __atomic_store_n(&swapflag, true, __ATOMIC_RELEASE);
+	}
+#endif
+
+	if(nBuffers > 2)
+	{
+		SWAP_LOCK();
+		i          = spareindex;
+		spareindex = backindex;
+		backindex  = i;
+		__atomic_store_n(&swapflag, true, __ATOMIC_RELEASE);
+		SWAP_UNLOCK();
+	}
+	else if(nBuffers == 2)
+	{
+		__atomic_store_n(&swapflag, true, __ATOMIC_RELEASE);
+	}
+}
+
+boolean RGBmatrixPanel4::swapPending(void)
+{
+	return (nBuffers == 2) && __atomic_load_n(&swapflag, __ATOMIC_ACQUIRE);
+}
+
+// Optional function called from the interrupt handler each time a swap
+// lands.  Keep it short (and in IRAM on ESP32); NULL disables it.
+void RGBmatrixPanel4::setSwapCallback(void (*callback)(void *), void *arg)
+{
+	swapcallback = NULL;     // So the ISR never pairs callback with a stale arg
+	swaparg      = arg;
+	swapcallback = callback;
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+// FreeRTOS alternative to a callback: the given task receives a notification
+// (see ulTaskNotifyTake()) each time a swap lands.  NULL disables it.
+void RGBmatrixPanel4::notifyOnSwap(TaskHandle_t task)
+{
+	swaptask = task;
+}
+#endif
+
+#if defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_ARCH_ESP32)
+// RGBMATRIX_EXPANDED mode: convert a buffer to the GPIO words the interrupt
+// handler outputs.  The whole buffer is redone; it's one table lookup per
+// byte, far less than the handler spends on it every refresh.
+void RGBmatrixPanel4::expandBuffer(uint8_t buf)
+{
+	const uint8_t *src = matrixbuff[buf];
+	PortType      *dst = wordbuff[buf];
+	uint16_t       i;
+	uint8_t        r;
+
+	for(r = 0; r < nRows; r++, src += rowbytes)
+	{
+#if RGBMATRIX_PACKED
+		// Unpack plane 0 from the low bits of planes 1-3, as the AVR
+		// handler does, so it isn't lost on SAMD either
+		for(i = 0; i < stride; i++)
+		{
+			*dst++ = expand[(uint8_t)(( src[i]               << 6)         |
+			                          ((src[i + stride]      << 4) & 0x30) |
+			                          ((src[i + stride * 2] << 2) & 0x0C))];
+		}
+#endif
+		for(i = 0; i < rowbytes; i++) *dst++ = expand[src[i]];
+	}
+}
+#endif
+
+// Dump display contents to the Serial Monitor, adding some formatting to
+// simplify copy-and-paste of data as a PROGMEM-embedded image for another
+// sketch.  If using multiple dumps this way, you'll need to edit the
+// output to change the 'img' name for each.  Data can then be loaded
+// back into the display using a pgm_read_byte() loop.
+void RGBmatrixPanel4::dumpMatrix(void) {
+
+  int i, buffsize = nRows * rowbytes; // All planes, every multiplexed row
+
+  Serial.print(F("\n\n"
+    "#include <avr/pgmspace.h>\n\n"
+    "static const uint8_t PROGMEM img[] = {\n  "));
+
+  for(i=0; i<buffsize; i++) {
+    Serial.print(F("0x"));
+    if(matrixbuff[backindex][i] < 0x10) Serial.write('0');
+    Serial.print(matrixbuff[backindex][i],HEX);
+    if(i < (buffsize - 1)) {
+      if((i & 7) == 7) Serial.print(F(",\n  "));
+      else             Serial.write(',');
+    }
+  }
+  Serial.println(F("\n};"));
+}
+
+// -------------------- Interrupt handler stuff --------------------
+/*
+ISR(TIMER1_OVF_vect, ISR_BLOCK)   // ISR_BLOCK important -- see notes later
+{
+	activePanel->updateDisplay();   // Call refresh func for active display
+	TIFR1 |= TOV1;                  // Clear Timer1 interrupt flag
+}
+*/
+
+#if defined(__AVR__)
+
+ISR(TIMER1_OVF_vect, ISR_BLOCK) { // ISR_BLOCK important -- see notes later
+  activePanel->updateDisplay();   // Call refresh func for active display
+  TIFR1 |= TOV1;                  // Clear Timer1 interrupt flag
+}
+
+#elif defined(ARDUINO_ARCH_SAMD)
 
 void IRQ_HANDLER() {
   activePanel->updateDisplay();   // Call refresh func for active display
@@ -753,20 +2272,23 @@ void IRQ_HANDLER() {
 }
 
 #elif defined(ARDUINO_ARCH_ESP32)
-IRAM_ATTR void IRQ_HANDLER(void *arg) {
-	int timer_idx = (int) arg;
+IRAM_ATTR void RGBmatrixPanel4::timerHandler(void *arg) {
+	RGBmatrixPanel4 *panel = (RGBmatrixPanel4 *)arg; // Set by begin()
+	timg_dev_t      *tg    = panel->timgroup ? &TIMERG1 : &TIMERG0;
+	int timer_idx = panel->timidx;
 	/* Retrieve the interrupt status and the counter value
 		 from the timer that reported the interrupt */
-	uint32_t intr_status = TIMERG1.int_st_timers.val;
-	activePanel->updateDisplay();   // Call refresh func for active display
+	uint32_t intr_status = tg->int_st_timers.val;
+	panel->updateDisplay();   // Call refresh func for this display
 	/* Clear the interrupt
 			 and update the alarm time for the timer with without reload */
-	if ((intr_status & BIT(timer_idx)) && timer_idx == TIMER_0) {
-		TIMERG1.int_clr_timers.t0 = 1;
+	if (intr_status & BIT(timer_idx)) {
+		if (timer_idx == TIMER_0) tg->int_clr_timers.t0 = 1;
+		else                      tg->int_clr_timers.t1 = 1;
 	}
 	/* After the alarm has been triggered
   	 we need enable it again, so it is triggered the next time */
-	TIMERG1.hw_timer[timer_idx].config.alarm_en = TIMER_ALARM_EN;
+	tg->hw_timer[timer_idx].config.alarm_en = TIMER_ALARM_EN;
 }
 
 #endif
@@ -833,6 +2355,195 @@ IRAM_ATTR void IRQ_HANDLER(void *arg) {
 // further adjusted by padding the LOOPTIME value, but refresh rates
 // will decrease proportionally, and 200 Hz is a decent target.
 
+// Rather than working the durations out on every interrupt, they're kept
+// in a table, one per plane, rebuilt whenever the timing changes.  The
+// constants above only give the default timing and, where the handler
+// can't be timed, its cost.  On ESP32 begin() measures the handler with
+// the CPU cycle counter, so longer chains or slower modes get the time
+// they actually need.
+#if defined(__AVR__)
+  #define TIMER_HZ F_CPU    // Timer1, no prescale
+#elif defined(ARDUINO_ARCH_SAMD)
+  #define TIMER_HZ 48000000 // TC4 on the 48 MHz clock
+#elif defined(ARDUINO_ARCH_ESP32)
+  #define TIMER_HZ 40000000 // 80 MHz APB clock, divider 2
+#endif
+
+// Cost estimates from the constants (the handler shifts the same amount
+// of data for every plane).
+void RGBmatrixPanel4::estimateTiming(void)
+{
+	uint8_t p;
+
+	// Measured with up to two panels' worth per row; longer chains take
+	// proportionally longer.
+	for(p = 0; p < nPlanes; p++)
+		planeticks[p] = ((nRows > 8) ? LOOPTIME : (LOOPTIME * 2)) *
+		                ((stride + 127) / 128);
+	applyTiming();
+}
+
+// Time one refresh cycle's worth of handler calls, keeping the worst case
+// for each plane loaded.  Called from begin() with everything set up but
+// the timer not yet started; the row and plane counters come full circle.
+void RGBmatrixPanel4::calibrate(void)
+{
+#if defined(ARDUINO_ARCH_ESP32)
+	uint8_t  i, p;
+	uint32_t c, mhz = getCpuFrequencyMhz();
+
+	for(p = 0; p < nPlanes; p++) planeticks[p] = 0;
+	dimmed = blanking = false; // One call per plane, until applyTiming()
+	for(i = 0; i < nRows * nPlanes; i++)
+	{
+		p = (plane + 1 < nPlanes) ? (plane + 1) : 0; // Plane this call loads
+		c = xthal_get_ccount();
+		updateDisplay();
+		c = xthal_get_ccount() - c;
+		c = (c * (TIMER_HZ / 1000000) + mhz - 1) / mhz; // CPU to timer ticks
+		if(c > planeticks[p]) planeticks[p] = c;
+	}
+	*oeport |= oepin; // Output off until the timer takes over
+	cpumhz = mhz;
+	applyTiming();
+	resetStats();     // Don't count the calls made here
+#endif
+}
+
+// Build the duration table.  Each plane is loaded while the one before it
+// is shown, so plane 0's interval (when plane 1 is loaded) must cover
+// plane 1's work, plane 1's interval plane 2's work, and so on, plus the
+// interrupt entry and exit either side.  That's the shortest usable plane
+// 0 time; requests for a rate or CPU share are held to it, and without
+// a request the timing is as before (LOOPTIME + CALLOVERHEAD * 2) unless
+// that's too short.
+void RGBmatrixPanel4::applyTiming(void)
+{
+	uint8_t  p, shown;
+	uint32_t base, c, lit, load, minbase = 0, busy = 0,
+	         units = (1UL << nPlanes) - 1; // Plane 0 intervals per row
+
+	for(p = 0; p < nPlanes; p++)
+	{
+		shown = p ? (p - 1) : (nPlanes - 1);
+		c     = (planeticks[p] + (1UL << shown) - 1) >> shown;
+		if(c > minbase) minbase = c;
+		busy += planeticks[p] + CALLOVERHEAD * 2;
+	}
+	minbase += CALLOVERHEAD * 2;
+
+	if(reqhz)         base = TIMER_HZ / ((uint32_t)reqhz * nRows * units);
+	else if(reqshare) base = (busy * 100 + reqshare * units - 1) / (reqshare * units);
+	else              base = ((nRows > 8) ? LOOPTIME : (LOOPTIME * 2)) + CALLOVERHEAD * 2;
+	if(base < minbase) base = minbase;
+#if !defined(ARDUINO_ARCH_ESP32)
+	if((base << (nPlanes - 1)) > 0xFFFF) base = 0xFFFF >> (nPlanes - 1); // 16 bit timer
+#endif
+
+	basetime = base;
+	rowticks = base * units;
+	for(p = 0; p < nPlanes; p++) durations[p] = (base << p) - CALLOVERHEAD;
+
+	// Dimmed, each interval is split in two: output on for a share of it
+	// (plane 0's share doubled each plane, so the weights hold), then an
+	// interrupt to turn it off for the rest.  The lit share can't be
+	// shorter than the interrupt entry and exit between the two, nor the
+	// blanked part.  Loading the next plane goes wherever it fits: while
+	// lit as usual, or, for the shortest shares, once blanked, stretching
+	// the interval if need be (dark time doesn't change the colors).
+	dimmed     = (brightness > 0) && (brightness < 255); // 0 never lights
+	lateplanes = 0;
+	if(!dimmed) return;
+	lit = (base * brightness + 127) / 255;
+	if(lit + CALLOVERHEAD * 2 > base) lit = base - CALLOVERHEAD * 2;
+	if(lit < CALLOVERHEAD * 2)        lit = CALLOVERHEAD * 2;
+	rowticks = 0;
+	for(p = 0; p < nPlanes; p++)
+	{
+		// Blanked part, and what loading the next plane takes
+		c    = (base > lit + CALLOVERHEAD * 2) ? (base - lit) : (CALLOVERHEAD * 2);
+		c  <<= p;
+		load = planeticks[(p + 1 < nPlanes) ? (p + 1) : 0] + CALLOVERHEAD * 2;
+		if((lit << p) < load)
+		{
+			lateplanes |= 1 << p;
+			if(c < load) c = load;
+		}
+		ontimes[p]  = (lit << p) - CALLOVERHEAD;
+		offtimes[p] = c - CALLOVERHEAD;
+		rowticks   += (lit << p) + c;
+	}
+}
+
+void RGBmatrixPanel4::setBrightness(uint8_t b)
+{
+	brightness = b;
+	applyTiming();
+#if defined(ARDUINO_ARCH_ESP32)
+	if(dmamode) getBitstream(&bitstream);
+#endif
+}
+
+uint8_t RGBmatrixPanel4::getBrightness(void)
+{
+	return brightness;
+}
+
+uint16_t RGBmatrixPanel4::setRefreshRate(uint16_t hz)
+{
+	reqhz    = hz;
+	reqshare = 0;
+	applyTiming();
+	return refreshRate();
+}
+
+uint16_t RGBmatrixPanel4::setMaxCpuShare(uint8_t percent)
+{
+	reqhz    = 0;
+	reqshare = (percent > 100) ? 100 : percent;
+	applyTiming();
+	return refreshRate();
+}
+
+uint16_t RGBmatrixPanel4::refreshRate(void)
+{
+	return TIMER_HZ / (rowticks * nRows);
+}
+
+RGBmatrixStats RGBmatrixPanel4::getStats(void)
+{
+	RGBmatrixStats stats;
+	uint8_t        p;
+
+	memset(&stats, 0, sizeof(stats));
+	stats.frames   = statframes;
+	stats.swaps    = statswaps;
+	stats.overruns = statoverruns;
+	for(p = 0; p < nPlanes; p++)
+	{
+		stats.isrMin[p] = statmax[p] ? statmin[p] : 0;
+		stats.isrMax[p] = statmax[p];
+		stats.isrAvg[p] = statavg16[p] >> 4;
+	}
+	stats.swapLatencyMax = swaplatmax;
+	stats.swapLatencyAvg = swaplatavg16 >> 4;
+	return stats;
+}
+
+void RGBmatrixPanel4::resetStats(void)
+{
+	uint8_t p;
+
+	statframes = statswaps = statoverruns = 0;
+	for(p = 0; p < 8; p++)
+	{
+		statmin[p]   = 0xFFFFFFFF;
+		statmax[p]   = 0;
+		statavg16[p] = 0;
+	}
+	swaplatmax = swaplatavg16 = 0;
+}
+
 // The flow of the interrupt can be awkward to grasp, because data is
 // being issued to the LED matrix for the *next* bitplane and/or row
 // while the *current* plane/row is being shown.  As a result, the
@@ -840,70 +2551,200 @@ IRAM_ATTR void IRQ_HANDLER(void *arg) {
 // function...hopefully tenses are sufficiently commented.
 
 
+// Called from interrupt context at the end of each complete refresh
+// cycle, by updateDisplay() or (see beginDMA()) the DMA interrupt: swap
+// front/back buffers if requested.
+#if defined(ARDUINO_ARCH_ESP32)
+IRAM_ATTR void RGBmatrixPanel4::endFrame(void) {
+#else
+void RGBmatrixPanel4::endFrame(void) {
+#endif
+	uint8_t  i;
+	uint32_t latency;
+
+	if(!__atomic_load_n(&swapflag, __ATOMIC_ACQUIRE)) return;
+
+	SWAP_LOCK_ISR();
+	if(nBuffers > 2)
+	{
+		// Show the queued frame, releasing the old front buffer
+		i          = frontindex;
+		frontindex = spareindex;
+		spareindex = i;
+	}
+	else if(nBuffers == 2)
+	{
+		frontindex = backindex;
+		backindex  = 1 - backindex;
+	}
+	__atomic_store_n(&swapflag, false, __ATOMIC_RELEASE);
+	SWAP_UNLOCK_ISR();
+
+	latency = micros() - swaptime;
+	if(latency > swaplatmax) swaplatmax = latency;
+	if(statswaps++) swaplatavg16 += latency - (swaplatavg16 >> 4);
+	else            swaplatavg16  = latency << 4;
+
+	if(swapcallback) swapcallback(swaparg);
+#if defined(ARDUINO_ARCH_ESP32)
+	if(swaptask)
+	{
+		BaseType_t woken = pdFALSE;
+		vTaskNotifyGiveFromISR(swaptask, &woken);
+		if(woken) portYIELD_FROM_ISR();
+	}
+#endif
+}
+
+#if defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_ARCH_ESP32)
+// Clock out one plane of a multiplexed row: N bytes through the expand[]
+// table, or N pre-expanded words.  The loop is unrolled 32 deep and its
+// trip count fixed at compile time, so the interrupt handler no longer
+// re-reads the chain geometry or tests nMultiplexRows on every call.
+// N = 0 is the general version, taking the length from 'stride'.
+#ifdef __SAMD51__ // No IOBUS on SAMD51
+ #define SHIFTNOP asm("nop");
+#else
+ #define SHIFTNOP
+#endif
+
+template<uint16_t N, bool WORDS>
+#if defined(ARDUINO_ARCH_ESP32)
+IRAM_ATTR
+#endif
+void RGBmatrixPanel4::shiftOut(const void *src)
+{
+	volatile PortType *set = outsetreg, *clr = outclrreg;
+	const PortType     rgbclk = rgbclkmask, clk = sclkpin;
+	const PortType    *words = (const PortType *)src;
+	const uint8_t     *bytes = (const uint8_t *)src;
+	uint16_t           n = (N ? N : stride) / 32;
+
+	#define pew                                  \
+	  *clr = rgbclk;                             \
+	  *set = WORDS ? *words++ : expand[*bytes++]; \
+	  *set = clk;                                \
+	  SHIFTNOP
+
+	do {
+		pew pew pew pew pew pew pew pew
+		pew pew pew pew pew pew pew pew
+		pew pew pew pew pew pew pew pew
+		pew pew pew pew pew pew pew pew
+	} while(--n);
+	*clr = clk; // Set clock low
+
+	#undef pew
+}
+
+// Pick the kernel for this chain, once the buffer mode is settled.
+// Specialised for 1 to 4 panels; longer chains use the general loop, as
+// does any chain with 'general' set (for timing the difference, see
+// "updateDisplay/general" in extras/host/matrixbench.cpp).
+void RGBmatrixPanel4::selectShifter(boolean general)
+{
+	typedef void (RGBmatrixPanel4::*Shifter)(const void *);
+	static const Shifter kernels[5][2] = {
+		{ &RGBmatrixPanel4::shiftOut<  0, false>, &RGBmatrixPanel4::shiftOut<  0, true> },
+		{ &RGBmatrixPanel4::shiftOut< 64, false>, &RGBmatrixPanel4::shiftOut< 64, true> },
+		{ &RGBmatrixPanel4::shiftOut<128, false>, &RGBmatrixPanel4::shiftOut<128, true> },
+		{ &RGBmatrixPanel4::shiftOut<192, false>, &RGBmatrixPanel4::shiftOut<192, true> },
+		{ &RGBmatrixPanel4::shiftOut<256, false>, &RGBmatrixPanel4::shiftOut<256, true> }
+	};
+	uint8_t k = (general || (stride % 64) || (stride / 64 > 4)) ? 0 : (stride / 64);
+
+	shifter = kernels[k][expanded ? 1 : 0];
+}
+#endif
+
 #if defined(ARDUINO_ARCH_ESP32)
 IRAM_ATTR void RGBmatrixPanel4::updateDisplay(void) {
 #else
 void RGBmatrixPanel4::updateDisplay(void) {
 #endif
 
-	uint8_t  i, tick, tock, *ptr;
-	uint16_t t, duration;
-	uint8_t panelcount;
+	uint8_t  *ptr, shown;
+	uint32_t duration;
+	boolean  blanked = blanking, load = true;
+#if defined(__AVR__)
+	uint8_t  i, tick, tock, panelcount; // Unrolled output and plane 0
+#endif
+#if defined(ARDUINO_ARCH_ESP32)
+	uint32_t cycles, start = xthal_get_ccount();
+#endif
 
 	*oeport  |= oepin;  // Disable LED output during row/plane switchover
-	*latport |= latpin; // Latch data loaded during *prior* interrupt
-
-	// Calculate time to next interrupt BEFORE incrementing plane #.
-	// This is because duration is the display time for the data loaded
-	// on the PRIOR interrupt.  CALLOVERHEAD is subtracted from the
-	// result because that time is implicit between the timer overflow
-	// (interrupt triggered) and the initial LEDs-off line at the start
-	// of this method.
-	t = (nRows > 8) ? LOOPTIME : (LOOPTIME * 2);		// Multiplier of 2 for 32x32pixel panel? Could also apply for 1/4 since double the row length
-	
-	duration = ((t + CALLOVERHEAD * 2) << plane) - CALLOVERHEAD;
 
-	// Borrowing a technique here from Ray's Logic:
-	// www.rayslogic.com/propeller/Programming/AdafruitRGB/AdafruitRGB.htm
-	// This code cycles through all four planes for each scanline before
-	// advancing to the next line.  While it might seem beneficial to
-	// advance lines every time and interleave the planes to reduce
-	// vertical scanning artifacts, in practice with this panel it causes
-	// a green 'ghosting' effect on black pixels, a much worse artifact.
-
-	if(++plane >= nPlanes)        // Advance plane counter.  Maxed out?
+	if(blanked)
+	{
+		// Dimmed, second interrupt of the interval (see applyTiming()):
+		// output stays off for the rest of it.  Nothing to latch; the
+		// next plane is loaded now if it didn't fit while lit.
+		blanking = false;
+		shown    = plane ? (plane - 1) : (nPlanes - 1);
+		duration = offtimes[shown];
+		load     = (lateplanes >> shown) & 1;
+	}
+	else
 	{
-		plane = 0;                  // Yes, reset to plane 0, and
-		if(++row >= nRows)          // advance row counter.  Maxed out?
+		*latport |= latpin; // Latch data loaded during *prior* interrupt
+
+		// Look up time to next interrupt BEFORE incrementing plane #.
+		// This is because duration is the display time for the data loaded
+		// on the PRIOR interrupt.  CALLOVERHEAD is subtracted in the table
+		// because that time is implicit between the timer overflow
+		// (interrupt triggered) and the initial LEDs-off line at the start
+		// of this method.  See applyTiming().
+		duration = durations[plane];
+		if(dimmed)
+		{
+			blanking = true;
+			load     = !((lateplanes >> plane) & 1);
+			duration = ontimes[plane];
+		}
+
+		// Borrowing a technique here from Ray's Logic:
+		// www.rayslogic.com/propeller/Programming/AdafruitRGB/AdafruitRGB.htm
+		// This code cycles through all four planes for each scanline before
+		// advancing to the next line.  While it might seem beneficial to
+		// advance lines every time and interleave the planes to reduce
+		// vertical scanning artifacts, in practice with this panel it causes
+		// a green 'ghosting' effect on black pixels, a much worse artifact.
+
+		if(++plane >= nPlanes)        // Advance plane counter.  Maxed out?
 		{
-			row     = 0;              // Yes, reset row counter, then...
-			if(swapflag == true)      // Swap front/back buffers if requested
+			plane = 0;                  // Yes, reset to plane 0, and
+			if(++row >= nRows)          // advance row counter.  Maxed out?
 			{
-				backindex = 1 - backindex;
-				swapflag  = false;
+				row     = 0;              // Yes, reset row counter, then...
+				statframes++;
+				endFrame();               // swap front/back buffers if requested
+				buffptr = matrixbuff[frontindex]; // Reset into front buffer
+#if defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_ARCH_ESP32)
+				wordptr = wordbuff[frontindex];
+#endif
 			}
-			buffptr = matrixbuff[1 - backindex]; // Reset into front buffer
 		}
-	}
-	else if(plane == 1)
-	{
-		// Plane 0 was loaded on prior interrupt invocation and is about to
-		// latch now, so update the row address lines before we do that:
-		if(row & 0x1)   *addraport |=  addrapin;
-		else            *addraport &= ~addrapin;
-		if(row & 0x2)   *addrbport |=  addrbpin;
-		else            *addrbport &= ~addrbpin;
-		if(nRows > 4) 	// Can be skipped for 1/4 scan panels, only 4 rows, C not used
-      {
-			if(row & 0x4)   *addrcport |=  addrcpin;
-			else            *addrcport &= ~addrcpin;
-		}
-		if(nRows > 8)
+		else if(plane == 1)
 		{
-			if(row & 0x8) *addrdport |=  addrdpin;
-			else          *addrdport &= ~addrdpin;
+			// Plane 0 was loaded on prior interrupt invocation and is about to
+			// latch now, so update the row address lines before we do that:
+			if(row & 0x1)   *addraport |=  addrapin;
+			else            *addraport &= ~addrapin;
+			if(row & 0x2)   *addrbport |=  addrbpin;
+			else            *addrbport &= ~addrbpin;
+			if(nRows > 4) 	// Can be skipped for 1/4 scan panels, only 4 rows, C not used
+			{
+				if(row & 0x4)   *addrcport |=  addrcpin;
+				else            *addrcport &= ~addrcpin;
+			}
+			if(nRows > 8)
+			{
+				if(row & 0x8) *addrdport |=  addrdpin;
+				else          *addrdport &= ~addrdpin;
+			}
 		}
-	} 
+	}
 
 	
 
@@ -929,13 +2770,17 @@ void RGBmatrixPanel4::updateDisplay(void) {
 #elif defined(ARDUINO_ARCH_ESP32)
   static timg_dev_t *TG[2] = {&TIMERG0, &TIMERG1};
   static portMUX_TYPE timer_spinlock[TIMER_GROUP_MAX] = {portMUX_INITIALIZER_UNLOCKED, portMUX_INITIALIZER_UNLOCKED};
-  portENTER_CRITICAL(&timer_spinlock[TIMER_GROUP_1]);
-  TG[TIMER_GROUP_1]->hw_timer[TIMER_0].alarm_high = (uint32_t) (duration >> 32);
-  TG[TIMER_GROUP_1]->hw_timer[TIMER_0].alarm_low = (uint32_t) duration;
-  portEXIT_CRITICAL(&timer_spinlock[TIMER_GROUP_1]);
+  portENTER_CRITICAL(&timer_spinlock[timgroup]);
+  TG[timgroup]->hw_timer[timidx].alarm_high = 0;
+  TG[timgroup]->hw_timer[timidx].alarm_low = (uint32_t) duration;
+  portEXIT_CRITICAL(&timer_spinlock[timgroup]);
 #endif // ARDUINO_ARCH_SAMD
-	*oeport  &= ~oepin;   // Re-enable output
-	*latport &= ~latpin;  // Latch down
+	if(!blanked)
+	{
+		if(brightness) *oeport &= ~oepin; // Re-enable output
+		*latport &= ~latpin;              // Latch down
+	}
+	if(!load) goto done; // Dimmed, loaded by the other interrupt
 
 	// Record current state of SCLKPORT register, as well as a second
 	// copy with the clock bit set.  This makes the innnermost data-
@@ -950,7 +2795,19 @@ void RGBmatrixPanel4::updateDisplay(void) {
 	tick = tock | sclkpin;
 #endif
 
-	if(plane > 0)   // 188 ticks from TCNT1=0 (above) to end of function
+#if defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_ARCH_ESP32)
+	if(expanded)
+	{
+		// Pre-expanded words, all planes: no byte loads or table lookups.
+		(this->*shifter)((const void *)wordptr);
+		wordptr += stride;
+	}
+	else
+#endif
+
+	// When not packed, plane 0 has its own bytes too and always takes
+	// this path.
+	if((plane > 0) || !RGBMATRIX_PACKED)   // 188 ticks from TCNT1=0 (above) to end of function
 	{
 
 		// Planes 1-3 copy bytes directly from RAM to PORT without unpacking.
@@ -966,58 +2823,27 @@ void RGBmatrixPanel4::updateDisplay(void) {
 		asm volatile("out %0,__tmp_reg__" :: "I"(_SFR_IO_ADDR(DATAPORT)));  \
 		asm volatile("out %0,%1" :: "I"(_SFR_IO_ADDR(SCLKPORT)),"r"(tick)); \
 		asm volatile("out %0,%1" :: "I"(_SFR_IO_ADDR(SCLKPORT)),"r"(tock));
-#elif defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_ARCH_ESP32)
-#ifdef __SAMD51__ // No IOBUS on SAMD51
-    #define pew                    \
-      *outclrreg = rgbclkmask;     \
-      *outsetreg = expand[*ptr++]; \
-      *outsetreg = sclkpin;        \
-      asm("nop");
-#else
-    #define pew                    \
-      *outclrreg = rgbclkmask;     \
-      *outsetreg = expand[*ptr++]; \
-      *outsetreg = sclkpin;
-#endif
-#endif
 	
-		for (panelcount = 0; panelcount < nPanels; panelcount++)
+		for (panelcount = 0; panelcount < nPanels * nMultiplexRows; panelcount++)
 		{
-			// Loop is unrolled for speed:
-			pew pew pew pew pew pew pew pew
-			pew pew pew pew pew pew pew pew
+			// Loop is unrolled for speed, 32 bytes per physical row:
 			pew pew pew pew pew pew pew pew
 			pew pew pew pew pew pew pew pew
-			
-			if (nMultiplexRows == 2) {
-			// Another 32 bytes for the extra multiplexed rows
 			pew pew pew pew pew pew pew pew
 			pew pew pew pew pew pew pew pew
-			pew pew pew pew pew pew pew pew
-			pew pew pew pew pew pew pew pew
-			}
 		}
 
 		// From the "Unsolved Mysteries" department: "buffptr += 32" doesn't
 		// work here, scrambles the display.  "buffptr = ptr" does, even though
 		// both should produce the same results.  Couldn't tell you why.
 
-#if defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_ARCH_ESP32)
-    *outclrreg = sclkpin; // Set clock low
-#endif
 //      buffptr = ptr; 
 		buffptr += 32 * nMultiplexRows * nPanels;
-/*	#else		// Code for none AVR (i.e. Duo and ARM based systems)
- 
-		for(i = 0; i < (32 * nMultiplexRows * nPanels ); i++)
-		{
-			DATAPORT = ptr[i];
-			SCLKPORT = tick; // Clock lo
-			SCLKPORT = tock; // Clock hi
-		}
-		buffptr += (32 * nMultiplexRows * nPanels);  // Move to next plane;
+	#else
+		// Kernel unrolled for the chain length, see shiftOut()
+		(this->*shifter)(ptr);
+		buffptr += stride;
 	#endif
-*/
 
 	}
 	else     // 920 ticks from TCNT1=0 (above) to end of function
@@ -1044,9 +2870,11 @@ void RGBmatrixPanel4::updateDisplay(void) {
 
 		}
 
-#elif defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_ARCH_ESP32)
+#elif defined(ARDUINO_ARCH_SAMD)
 
-// This commented out gets rid of shadowing on 1:4 displays.
+// This commented out gets rid of shadowing on 1:4 displays.  (It only
+// clocks out WIDTH bytes of the multiplexed row.  ESP32 avoids this
+// altogether by storing plane 0 unpacked, see RGBMATRIX_PLANEBYTES.)
 /*    for (int i=0; i<WIDTH; i++) {
       byte b = 
 	( ptr[i]         << 6)         |
@@ -1061,5 +2889,24 @@ void RGBmatrixPanel4::updateDisplay(void) {
 */
 #endif
 	}
+
+done:
+#if defined(ARDUINO_ARCH_ESP32)
+	// Statistics.  Costs are kept for calls that loaded a plane (dimmed,
+	// the others only latch or blank); every call is checked for an
+	// overrun, which is when it, plus the interrupt entry and exit,
+	// outlasts the period just set.
+	cycles = xthal_get_ccount() - start;
+	if(load)
+	{
+		if(cycles < statmin[plane]) statmin[plane] = cycles;
+		if(cycles > statmax[plane]) statmax[plane] = cycles;
+		if(statavg16[plane]) statavg16[plane] += cycles - (statavg16[plane] >> 4);
+		else                 statavg16[plane]  = cycles << 4;
+	}
+	if(cycles * (TIMER_HZ / 1000000) + CALLOVERHEAD * cpumhz > duration * cpumhz)
+		statoverruns++;
+#endif
+	return;
 }
 
@@ -1,3 +1,6 @@
+#ifndef _RGBMATRIXPANEL4_H_
+#define _RGBMATRIXPANEL4_H_
+
 #if ARDUINO >= 100
  #include "Arduino.h"
 #else
@@ -5,6 +8,11 @@
  #include "pins_arduino.h"
 #endif
 #include "Adafruit_GFX.h"
+#if defined(ARDUINO_ARCH_ESP32)
+ #include "freertos/FreeRTOS.h"
+ #include "freertos/task.h"
+ #include "RGBmatrixBitstream.h"
+#endif
 
 #if defined(__AVR__)
   typedef uint8_t  PortType;
@@ -12,13 +20,117 @@
   typedef uint32_t PortType; // Formerly 'RwReg' but interfered w/CMCIS header
 #endif
 
+// Colour depth, as the number of BCM bitplanes.  4 (4/4/4 color) unless
+// built with e.g. -DRGBMATRIX_PLANES=6; 3 to 8 are supported, depths other
+// than 4 needing a byte per plane.  Each extra plane doubles the refresh
+// time at the same plane 0 interval.
+#ifndef RGBMATRIX_PLANES
+ #define RGBMATRIX_PLANES 4
+#endif
+
+// Bytes used to store the planes of each pair of LEDs (one pixel from
+// the upper half, one from the lower).  Planes 1-3 get a byte each, laid
+// out for direct output.  Normally plane 0 is packed into the 2 spare bits
+// of those and unpacked by the interrupt handler; on ESP32 (or at other
+// depths) it gets a byte of its own so the handler can output it the
+// same way as the others.
+// (Building ESP32 with -DRGBMATRIX_PLANEBYTES=3 saves RAM but drops plane 0.)
+#ifndef RGBMATRIX_PLANEBYTES
+ #if defined(ARDUINO_ARCH_ESP32) || (RGBMATRIX_PLANES != 4)
+  #define RGBMATRIX_PLANEBYTES RGBMATRIX_PLANES
+ #else
+  #define RGBMATRIX_PLANEBYTES 3
+ #endif
+#endif
+#define RGBMATRIX_PACKED (RGBMATRIX_PLANEBYTES < RGBMATRIX_PLANES)
+#if (RGBMATRIX_PLANES < 3) || (RGBMATRIX_PLANES > 8) || \
+    (RGBMATRIX_PACKED ? (RGBMATRIX_PLANES != 4) || (RGBMATRIX_PLANEBYTES != 3) \
+                      : (RGBMATRIX_PLANEBYTES != RGBMATRIX_PLANES))
+ #error "RGBMATRIX_PLANES must be 3-8 with a byte per plane, or 4 packed in 3 bytes"
+#endif
+
+// Build with -DRGBMATRIX_SHADOW=1 to draw into a plain 5/6/5 copy of the
+// display (the shadow, 2 bytes per pixel more RAM) rather than into the
+// frame buffer.  A pixel is then a single store instead of a masked store
+// per plane byte, and the shadow is packed into the bitplane layout in one
+// pass, whole plane words at a time, when the frame is queued
+// (requestSwap(), swapBuffers(), or dirtyRows() and backBuffer(), which
+// need the buffer up to date).  The pack costs about as much as drawing
+// every row it covers directly, so this pays off on frames mostly filled
+// and blitted over ("frame/fill" in extras/host/matrixbench.cpp); text
+// on a cleared screen, as the clock's screens are, is as quick or quicker
+// drawn directly ("frame/text").  Single buffered, what's drawn only shows
+// after requestSwap().  Needs a byte per plane.
+#ifndef RGBMATRIX_SHADOW
+ #define RGBMATRIX_SHADOW 0
+#endif
+#if RGBMATRIX_SHADOW && RGBMATRIX_PACKED
+ #error "RGBMATRIX_SHADOW needs a byte per plane (RGBMATRIX_PLANEBYTES == RGBMATRIX_PLANES)"
+#endif
+
+// Values for the constructor's dbuf argument (false/true still work too):
+#define RGBMATRIX_SINGLEBUF 0
+#define RGBMATRIX_DOUBLEBUF 1
+#define RGBMATRIX_TRIPLEBUF 2
+// Flag to OR into dbuf (SAMD and ESP32): keep a copy of each buffer with
+// every byte pre-expanded to its GPIO set-mask, so the interrupt handler
+// just streams words out.  4x the RAM per buffer for a shorter interrupt;
+// the copy is made by requestSwap()/swapBuffers(), so single buffered,
+// call requestSwap() to show what has been drawn.
+#define RGBMATRIX_EXPANDED  0x10
+
+// Refresh statistics, see getStats().  Interrupt handler costs are in CPU
+// cycles, kept per plane loaded, and (like overruns) only measured on ESP32.
+typedef struct {
+  uint32_t frames;          // Refresh cycles completed
+  uint32_t swaps;           // Buffer swaps applied
+  uint32_t overruns;        // Handler calls that outlasted their timer period
+  uint32_t isrMin[8], isrMax[8], isrAvg[8];
+  uint32_t swapLatencyMax,  // requestSwap() to the swap landing, microseconds
+           swapLatencyAvg;
+} RGBmatrixStats;
+
+// Wiring of a multiplexed row, see setScanPattern().  Panels light
+// 'nmux' physical rows per half of the display at each row address; the
+// data for all of them goes through one shift register, 32 * nmux LEDs
+// long per panel.  Given an LED's column (0-31) and which of those rows it
+// is in (0 = top), return its position in the order that panel's data is
+// clocked out (0 first, up to 32 * nmux - 1).
+typedef uint16_t (*RGBmatrixScanMap)(uint8_t x, uint8_t mux, uint8_t nmux);
+
+// Built-in wirings.  Snake: runs of 8 LEDs alternating between the rows,
+// the upper row's run last (the common 1/4 scan P10 layout).  Linear:
+// whole rows one after the other, again the upper row last.  They are the
+// same when each row address lights just one row per half.
+uint16_t RGBmatrixScanSnake(uint8_t x, uint8_t mux, uint8_t nmux);
+uint16_t RGBmatrixScanLinear(uint8_t x, uint8_t mux, uint8_t nmux);
+
+// Images compressed for flash, made from PNGs by extras/png2atlas.py and
+// drawn with drawImage().  Each image is a run-length coded stream of its
+// pixels, row after row: a byte 0nnnnnnn is n + 1 transparent pixels, a
+// byte 1nnnnnnn n + 1 pixels of the palette color in the byte after it.
+// The palette (5/6/5) is shared by all images of an atlas.  The palette,
+// data and entries live in PROGMEM; the RGBmatrixAtlas itself (pointers
+// to them and the count, read directly by drawImage()) is in RAM.
+typedef struct {
+  uint8_t  width, height;
+  uint32_t offset;                    // First run of the image in 'data'
+} RGBmatrixAtlasEntry;
+
+typedef struct {
+  const uint16_t            *palette;
+  const uint8_t             *data;
+  const RGBmatrixAtlasEntry *entries;
+  uint8_t                    count;   // Images
+} RGBmatrixAtlas;
+
 class RGBmatrixPanel4 : public Adafruit_GFX {
 
  public:
 
   // Constructor for 16x32 panel:
   RGBmatrixPanel4(uint8_t a, uint8_t b, uint8_t c,
-    uint8_t sclk, uint8_t latch, uint8_t oe, boolean dbuf, uint8_t pwidth
+    uint8_t sclk, uint8_t latch, uint8_t oe, uint8_t dbuf, uint8_t pwidth
 #if defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_ARCH_ESP32)
     ,uint8_t *pinlist=NULL
 #endif
@@ -27,27 +139,119 @@ class RGBmatrixPanel4 : public Adafruit_GFX {
     a, b, c are the pins used for addressing the rows
     cclk, latch and oe are the pins used for Serial Clock, Latach and Output Enable
     dbuf enables double buffering. This will use 2x RAM for frame buffer, but will give nice smooth animation
+      Pass RGBMATRIX_TRIPLEBUF (3x RAM) to always have a free buffer to draw into, see requestSwap()
     pwidth is the number of Panels used together in a multi panel configuration
     */
 
-  // Constructor for 32x32 panel (adds 'd' pin): (THIS HAS NOT BEEN TESTED WITH MULTIPLE PANELS)
+  // Constructor for 32x32 panel (adds 'd' pin).  Assumes 1/8 scan snake
+  // wiring, see setScanPattern() for others.
   RGBmatrixPanel4(uint8_t a, uint8_t b, uint8_t c, uint8_t d,
-    uint8_t sclk, uint8_t latch, uint8_t oe, boolean dbuf,uint8_t pwidth
+    uint8_t sclk, uint8_t latch, uint8_t oe, uint8_t dbuf,uint8_t pwidth
 #if defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_ARCH_ESP32)
     ,uint8_t *pinlist=NULL
 #endif
     );
 
+  // Stops the refresh (see end()) and frees the buffers
+  ~RGBmatrixPanel4(void);
+
   void
     begin(void),
+    end(void),
     drawPixel(int16_t x, int16_t y, uint16_t c),
+    drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t c),
+    drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t c),
+    fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t c),
+    writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t c),
     fillScreen(uint16_t c),
+    setRotation(uint8_t r),
     updateDisplay(void),
     swapBuffers(boolean),
+    requestSwap(void),
+    setSwapCallback(void (*callback)(void *), void *arg = NULL),
+    markDirty(uint32_t rows),
     dumpMatrix(void),
 	getPtrAddress(void);
+  boolean
+    swapPending(void);
+  // With requestSwap(): bring the back buffer up to date with the frame
+  // last queued, copying only the rows that differ, to carry on drawing
+  // over it -- what swapBuffers(true) does, without waiting for the swap.
+  void
+    syncBackBuffer(void);
+#if defined(ARDUINO_ARCH_ESP32)
+  // begin() using a particular hardware timer (group 0 or 1, timer 0 or
+  // 1; begin() uses group 1 timer 0).  Each instance refreshed at the same
+  // time needs its own timer and its own pins, every one of them: the
+  // address lines too, as the interrupt handlers aren't synchronised and
+  // each would change the row address while the other chain's row is lit.
+  // Returns false, doing nothing, if this instance is already running or
+  // another one holds the timer (begin() likewise does nothing then).
+  boolean
+    begin(uint8_t group, uint8_t timer);
+  void
+    notifyOnSwap(TaskHandle_t task);
+  // Alternative to begin(): refresh by I2S DMA instead of the timer
+  // interrupt.  All pins are driven by I2S1, which must not be used for
+  // anything else.  Returns false if out of DMA capable memory, or
+  // already running.
+  boolean
+    beginDMA(void);
+  // Set up 'b' to model this display's refresh (as used by beginDMA()),
+  // e.g. to simulate the pin sequence off-target.  Timing is the DMA
+  // stream's, in samples.
+  void
+    getBitstream(RGBmatrixBitstream *b);
+#endif
+  uint32_t
+    dirtyRows(void);
+  // Counters kept by the driver since begin() or resetStats().  Averages
+  // are running averages over roughly the last 16 samples.
+  RGBmatrixStats
+    getStats(void);
+  void
+    resetStats(void);
+  // Scan pattern, before begin(): the number of row addresses ('scan', 4
+  // for 1/4 scan and so on, up to 16 which needs the 'd' pin) and how the
+  // LEDs sharing one are chained.  The default is 1/4 scan snake for 16
+  // row panels, 1/8 scan snake for 32.  Returns false (leaving the layout
+  // as it was) if 'scan' doesn't suit the panel height.
+  boolean
+    setScanPattern(uint8_t scan, RGBmatrixScanMap map = RGBmatrixScanSnake);
+  // Panels mounted as a wall rather than one row, before drawing: 'cols'
+  // across by 'rows' down (cols * rows being the constructor's pwidth),
+  // drawn as a single canvas.  The chain runs from the top left panel
+  // along the top row as usual; with 'serpentine' set, every other row of
+  // panels runs back right to left, mounted upside down so the cables
+  // zig-zag.  Returns false if the panel count doesn't match.
+  boolean
+    setTiling(uint8_t cols, uint8_t rows, boolean serpentine = true);
+  // Refresh timing: aim for a refresh rate, or the fastest refresh that
+  // keeps the interrupt handler within a share of CPU time.  Limited by
+  // what the handler needs (measured by begin() on ESP32); both return the
+  // resulting refresh rate in Hz.  Either can be called before begin().
+  uint16_t
+    setRefreshRate(uint16_t hz),
+    setMaxCpuShare(uint8_t percent),
+    refreshRate(void);
+  // Global brightness, 0 (off) to 255 (full, the default), by shortening
+  // the time the output is enabled within each BCM interval -- the frame
+  // buffer and color depth are untouched.  Timer driven, each interval
+  // then takes two interrupts (the second blanks the output), and the
+  // lowest levels are held to what the interrupt latency allows; dimming
+  // can lower the refresh rate a little where plane 0's interval is short.
+  // With beginDMA() it's exact, and applies from the next requestSwap().
+  void
+    setBrightness(uint8_t b);
+  uint8_t
+    getBrightness(void);
   uint8_t
     *backBuffer(void);
+  // Read a pixel back as 5/6/5 color, at the depth it's displayed with:
+  // from the back buffer, or from 'frame' if given, a buffer in the one
+  // byte per plane layout RGBmatrixBitstream::decode() produces.
+  uint16_t
+    getPixel(int16_t x, int16_t y, const uint8_t *frame = NULL);
   uint16_t
     Color333(uint8_t r, uint8_t g, uint8_t b),
     Color444(uint8_t r, uint8_t g, uint8_t b),
@@ -55,16 +259,157 @@ class RGBmatrixPanel4 : public Adafruit_GFX {
     Color888(uint8_t r, uint8_t g, uint8_t b, boolean gflag),
     ColorHSV(long hue, uint8_t sat, uint8_t val, boolean gflag);
 
-  // Printing
+  // Printing.  Text in the built-in font (at size 1) is drawn straight
+  // into the back buffer, with each text color packed into plane bytes
+  // once and kept in a small cache, rather than by Adafruit_GFX one
+  // drawPixel() at a time; characters off the display are skipped whole.
+  // Other fonts and sizes go through Adafruit_GFX.
+  size_t
+    write(uint8_t c),
+    write(const uint8_t *buffer, size_t size);
+  using Print::write;
+  void
+    drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color,
+      uint16_t bg, uint8_t size_x, uint8_t size_y);
+  using Adafruit_GFX::drawChar;
+  // Scrolling banners.  Print the banner once into a GFXcanvas1 (the
+  // strip, not rotated), then each frame drawScroll() shows the window
+  // onto it starting at strip column 'offset' in rows y onwards, across
+  // the whole width -- same result as printing at x = -offset, but the
+  // cost no longer depends on the text.  Set bits are drawn in 'color',
+  // the rest in 'bg' unless it's the same (transparent, like text; then
+  // only the set bits are visited, a strip byte at a time).
+  void
+    drawScroll(const GFXcanvas1 *strip, int16_t y, int16_t offset,
+      uint16_t color, uint16_t bg);
+
+  // Color bitmaps (w x h, row by row) are clipped once and written
+  // straight into the back buffer, each run of one color packed once,
+  // rather than by Adafruit_GFX one drawPixel() at a time.  Same as
+  // Adafruit_GFX, a const bitmap is read from PROGMEM.  With a 'key',
+  // pixels of that color are left as they are (transparent).  RGB444
+  // bitmaps hold 0x0RGB, the key too.
+  void
+    drawRGBBitmap(int16_t x, int16_t y, const uint16_t bitmap[],
+      int16_t w, int16_t h),
+    drawRGBBitmap(int16_t x, int16_t y, uint16_t *bitmap,
+      int16_t w, int16_t h),
+    drawRGBBitmap(int16_t x, int16_t y, const uint16_t bitmap[],
+      int16_t w, int16_t h, uint16_t key),
+    drawRGBBitmap(int16_t x, int16_t y, uint16_t *bitmap,
+      int16_t w, int16_t h, uint16_t key),
+    drawRGB444Bitmap(int16_t x, int16_t y, const uint16_t bitmap[],
+      int16_t w, int16_t h),
+    drawRGB444Bitmap(int16_t x, int16_t y, const uint16_t bitmap[],
+      int16_t w, int16_t h, uint16_t key);
+  using Adafruit_GFX::drawRGBBitmap;
+  // Draw image 'index' of an atlas (see RGBmatrixAtlas) with its top left
+  // corner at x, y, clipped to the display.  Each run is packed once.
+  void
+    drawImage(const RGBmatrixAtlas *atlas, uint8_t index, int16_t x, int16_t y);
+
  private:
 
-  uint8_t *matrixbuff[2];
-  uint8_t nRows, nPlanes, backindex, nPanels, nMultiplexRows, nCounter;
-  boolean swapflag, written;
+  friend class RGBmatrixAnimation; // Writes frames into the buffer directly
+  friend class RGBmatrixBench;     // Times the kernels, extras/host/matrixbench.cpp
+
+  uint8_t *matrixbuff[3];
+  uint8_t nRows, nPlanes, backindex, nPanels, nMultiplexRows, nCounter, nBuffers;
+  volatile uint8_t frontindex;            // Buffer being shown by the ISR
+  uint8_t spareindex;                     // Triple buffering: queued or free
+  boolean written;
+  volatile boolean swapflag;              // Set by app, cleared by ISR on swap
+  void (*swapcallback)(void *);           // Called from ISR after a swap
+  void *swaparg;
+#if defined(ARDUINO_ARCH_ESP32)
+  TaskHandle_t swaptask;                  // Notified from ISR after a swap
+#endif
+  uint8_t lastindex;                      // Buffer most recently queued
+  uint16_t stride;    // Bytes between successive planes of a multiplexed row
+  uint16_t rowbytes;  // Bytes per multiplexed row, all planes
+  uint16_t *pixelmap; // Buffer offset per (x,y); bit 15 set for lower half
+  uint8_t  *rowmap;   // Multiplexed row of each 32 byte chunk of a buffer
+  RGBmatrixScanMap scanmap; // Wiring within a multiplexed row
+  uint8_t  tilecols, tilerows; // Panel arrangement, see setTiling()
+  boolean  serpentine;
+
+  // Dirty row tracking, one bit per multiplexed row:
+  uint32_t drawnrows,     // Drawn into since the last clear or swap
+           clearedrows,   // Changed by clears since the last swap
+           inkrows[3],    // Per buffer: may be non-zero (as of last clear)
+           stalerows[3];  // Per buffer: may differ from the latest frame
+
+#if RGBMATRIX_SHADOW
+  // Shadow framebuffer, see RGBMATRIX_SHADOW:
+  uint16_t *shadow;     // 5/6/5 color of each pixel, y * _width + x
+  uint16_t *packmap;    // Shadow index of each LED pair's upper and lower
+                        // pixel, in buffer order (the inverse of pixelmap)
+  uint32_t *linerows;   // Multiplexed rows each line of pixels lands in
+  uint32_t  shadowrows, // Changed in the shadow since the last pack
+            shadowink;  // May be non-zero, in the shadow or the buffer
+  void packShadow(void);
+#endif
+
+#if defined(ARDUINO_ARCH_ESP32)
+  // DMA refresh, see beginDMA():
+  boolean             dmamode;
+  RGBmatrixBitstream  bitstream;   // Pin sequence generator
+  uint16_t           *dmabuff[2];  // Sample streams: playing, idle/queued
+  void               *dmadesc[2];  // Descriptor chain (lldesc_t) for each
+  uint16_t            ndesc;       // Descriptors per chain
+  uint32_t            nsamples;    // Samples per stream (one refresh cycle)
+  volatile uint8_t    dmafront;    // Index of the stream playing
+  void               *dmaintr;     // Interrupt handle (intr_handle_t)
+  void loadDMA(uint8_t buf);
+  void dmaPins(uint32_t *pins); // 13 pins, in sample bit order
+  static void dmaHandler(void *arg);
+  // Timer refresh, see begin(group, timer):
+  uint8_t             timgroup, timidx;
+  void               *timintr;     // Interrupt handle (intr_handle_t)
+  static void timerHandler(void *arg);
+  portMUX_TYPE        swapmux;     // Swap handshake vs. interrupt handler
+#endif
+  // BCM timing, in timer ticks:
+  uint32_t planeticks[8];  // Interrupt cost when loading each plane
+  uint32_t durations[8];   // Timer period after loading each plane
+  uint32_t basetime;       // Display time of plane 0
+  uint32_t rowticks;       // Display time of all planes of a row
+  // Dimmed timing, see setBrightness():
+  uint32_t ontimes[8];     // Timer period while each plane is shown
+  uint32_t offtimes[8];    // Then blanked until the next plane
+  uint8_t  lateplanes;     // Planes whose next plane loads when blanked
+  uint8_t  brightness;
+  boolean  dimmed;
+  volatile boolean blanking; // Next interrupt blanks the output
+  uint16_t reqhz;          // Requested refresh rate, 0 = none
+  uint8_t  reqshare;       // Requested max CPU share, 0 = none
+  // Statistics, see getStats():
+  volatile uint32_t statframes, statswaps, statoverruns;
+  uint32_t statmin[8], statmax[8], statavg16[8]; // Average scaled by 16
+  uint32_t swaplatmax, swaplatavg16;
+  volatile uint32_t swaptime;                    // micros() at requestSwap()
+  uint32_t cpumhz;
+  void estimateTiming(void);
+  void calibrate(void);
+  void applyTiming(void);
+  // Swap bookkeeping at the end of a refresh cycle (interrupt context):
+  void endFrame(void);
+  // Rebuild pixelmap for the current rotation:
+  void buildPixelMap(void);
+  // Clip and fill a rectangle directly in the back buffer:
+  void fillArea(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t c);
+  // Clip and copy a color bitmap, flags as RGBMATRIX_BLIT_* in the .cpp:
+  void blitArea(int16_t x, int16_t y, const uint16_t *bitmap,
+    int16_t w, int16_t h, uint8_t flags, uint16_t key);
+  // Text colors packed for each half of the display, see textColor():
+  uint16_t glyphkey[4];
+  uint8_t  glyphcolor[4][2][RGBMATRIX_PLANEBYTES];
+  uint8_t  glyphvalid;
+  const uint8_t (*textColor(uint16_t c))[RGBMATRIX_PLANEBYTES];
     
   // Init/alloc code common to both constructors:
   void init(uint8_t rows, uint8_t a, uint8_t b, uint8_t c,
-    uint8_t sclk, uint8_t latch, uint8_t oe, boolean dbuf, uint8_t pwidth
+    uint8_t sclk, uint8_t latch, uint8_t oe, uint8_t dbuf, uint8_t pwidth
 #if defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_ARCH_ESP32)
             ,uint8_t *rgbpins
 #endif
@@ -87,6 +432,16 @@ class RGBmatrixPanel4 : public Adafruit_GFX {
   volatile PortType *outsetreg, *outclrreg; // PORT bit set, clear registers
   PortType           rgbclkmask;            // Mask of all RGB bits + CLK
   PortType           expand[256];           // 6-to-32 bit converter table
+  // RGBMATRIX_EXPANDED mode: GPIO words for each buffer, all planes
+  boolean            expanded;
+  PortType          *wordbuff[3];
+  volatile PortType *wordptr;               // Interrupt handler's position
+  void expandBuffer(uint8_t buf);
+  // Interrupt handler's shift-out kernel, chosen by begin() for the chain
+  // length (N bytes per plane, 0 = any) and buffer mode:
+  template<uint16_t N, bool WORDS> void shiftOut(const void *src);
+  void (RGBmatrixPanel4::*shifter)(const void *src);
+  void selectShifter(boolean general = false);
 #endif
 
   // Counters/pointers for interrupt handler:
@@ -94,3 +449,5 @@ class RGBmatrixPanel4 : public Adafruit_GFX {
   volatile uint8_t *buffptr;
 };
 
+
+#endif // _RGBMATRIXPANEL4_H_
@@ -0,0 +1 @@
+// Not needed on the host; Adafruit_GFX.h includes it unconditionally.
@@ -0,0 +1,63 @@
+// Host stand-in for the Arduino core, just what RGBmatrixPanel4 and
+// Adafruit_GFX need to build natively.  See matrixsim.cpp.
+
+#ifndef _HOST_ARDUINO_H_
+#define _HOST_ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+typedef bool    boolean;
+typedef uint8_t byte;
+
+#define HIGH   1
+#define LOW    0
+#define INPUT  0
+#define OUTPUT 1
+
+#define PROGMEM
+#define IRAM_ATTR
+#define pgm_read_byte(addr)  (*(const uint8_t  *)(addr))
+#define pgm_read_word(addr)  (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+
+#define BIT(n) (1UL << (n))
+
+// Binary constants used by the library
+#define B00011100 0x1C
+#define B00011101 0x1D
+#define B00011111 0x1F
+#define B11100000 0xE0
+#define B11100010 0xE2
+#define B11100011 0xE3
+#define B11111100 0xFC
+
+#include "Print.h"
+#include "Stream.h"
+
+// Every pin has a port register of its own, so writes can be inspected
+extern volatile uint32_t host_port[64];
+
+inline void     pinMode(uint8_t, uint8_t) { }
+inline void     digitalWrite(uint8_t, uint8_t) { }
+inline uint8_t  digitalPinToPort(uint8_t pin) { return pin & 63; }
+inline uint32_t digitalPinToBitMask(uint8_t pin) { return 1UL << (pin & 31); }
+inline volatile uint32_t *portOutputRegister(uint8_t port)
+  { return &host_port[port & 63]; }
+
+inline void noInterrupts(void) { }
+inline void interrupts(void) { }
+
+// Time only passes in delay(), which is also where the timer interrupts
+// run; see host.cpp
+void          delay(unsigned long ms);
+unsigned long millis(void);
+unsigned long micros(void);
+
+inline uint32_t getCpuFrequencyMhz(void) { return 240; }
+
+#endif // _HOST_ARDUINO_H_
@@ -0,0 +1,87 @@
+// Host stand-in for the Arduino Print class (and the bits of String and
+// F() that Adafruit_GFX refers to).  See matrixsim.cpp.
+
+#ifndef _HOST_PRINT_H_
+#define _HOST_PRINT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+class __FlashStringHelper;
+#define F(str) (reinterpret_cast<const __FlashStringHelper *>(str))
+
+class String {
+ public:
+  String(const char *str = "") : s(str) { }
+  unsigned int length(void) const { return strlen(s); }
+  const char  *c_str(void) const { return s; }
+ private:
+  const char *s;
+};
+
+#define DEC 10
+#define HEX 16
+
+class Print {
+ public:
+  virtual ~Print() { }
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buf, size_t n) {
+    size_t r = 0;
+    while(n--) r += write(*buf++);
+    return r;
+  }
+  size_t write(const char *str) {
+    return str ? write((const uint8_t *)str, strlen(str)) : 0;
+  }
+  size_t print(const char *str) { return write(str); }
+  size_t print(const __FlashStringHelper *str) {
+    return write((const char *)str);
+  }
+  size_t print(const String &str) { return write(str.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(long n, int base = DEC) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), (base == HEX) ? "%lX" : "%ld", n);
+    return write(buf);
+  }
+  size_t print(int n, int base = DEC) { return print((long)n, base); }
+  size_t print(unsigned int n, int base = DEC) {
+    return print((long)n, base);
+  }
+  size_t print(unsigned long n, int base = DEC) {
+    return print((long)n, base);
+  }
+  size_t print(double n, int digits = 2) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.*f", digits, n);
+    return write(buf);
+  }
+  size_t printf(const char *format, ...)
+    __attribute__ ((format (printf, 2, 3))) {
+    char    buf[64];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    return write(buf);
+  }
+  size_t println(void) { return write("\r\n"); }
+  template<typename T> size_t println(T v) { return print(v) + println(); }
+  template<typename T> size_t println(T v, int f) {
+    return print(v, f) + println();
+  }
+};
+
+class HostSerial : public Print {
+ public:
+  void   begin(unsigned long) { }
+  size_t write(uint8_t c) { return fputc(c, stderr) == EOF ? 0 : 1; }
+  using Print::write;
+};
+extern HostSerial Serial;
+
+#endif // _HOST_PRINT_H_
@@ -0,0 +1,24 @@
+// Host stand-in for the Arduino Stream class, as far as RGBmatrixAnimation
+// reads one.  See matrixsim.cpp.
+
+#ifndef _HOST_STREAM_H_
+#define _HOST_STREAM_H_
+
+#include "Print.h"
+
+class Stream : public Print {
+ public:
+  virtual int available(void) = 0;
+  virtual int read(void) = 0;
+  virtual int peek(void) = 0;
+  size_t write(uint8_t) { return 0; }
+  using Print::write;
+  virtual size_t readBytes(char *buf, size_t n) {
+    size_t r = 0;
+    int    c;
+    while((r < n) && ((c = read()) >= 0)) buf[r++] = c;
+    return r;
+  }
+};
+
+#endif // _HOST_STREAM_H_
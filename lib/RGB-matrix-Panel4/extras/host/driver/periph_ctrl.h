@@ -0,0 +1,9 @@
+// Host stand-in for the ESP-IDF peripheral clock control.
+
+#ifndef _HOST_DRIVER_PERIPH_CTRL_H_
+#define _HOST_DRIVER_PERIPH_CTRL_H_
+
+enum { PERIPH_I2S1_MODULE };
+inline void periph_module_enable(int) { }
+
+#endif // _HOST_DRIVER_PERIPH_CTRL_H_
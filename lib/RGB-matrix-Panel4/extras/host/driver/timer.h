@@ -0,0 +1,49 @@
+// Host stand-in for the ESP-IDF timer driver.  Registered handlers are
+// called from delay() while their timer is started; see host.cpp.
+
+#ifndef _HOST_DRIVER_TIMER_H_
+#define _HOST_DRIVER_TIMER_H_
+
+#include <stdint.h>
+
+typedef enum { TIMER_GROUP_0, TIMER_GROUP_1, TIMER_GROUP_MAX } timer_group_t;
+typedef enum { TIMER_0, TIMER_1, TIMER_MAX } timer_idx_t;
+enum { TIMER_PAUSE, TIMER_START };
+enum { TIMER_COUNT_DOWN, TIMER_COUNT_UP };
+enum { TIMER_INTR_LEVEL };
+enum { TIMER_ALARM_DIS, TIMER_ALARM_EN };
+
+typedef struct {
+  int      alarm_en, counter_en, intr_type, counter_dir, auto_reload;
+  uint32_t divider;
+} timer_config_t;
+
+typedef struct {
+  struct {
+    struct { uint32_t alarm_en; } config;
+    uint32_t cnt_low, cnt_high, update, alarm_low, alarm_high;
+  } hw_timer[2];
+  union {
+    struct { uint32_t t0 : 1, t1 : 1; };
+    uint32_t val;
+  } int_st_timers, int_clr_timers;
+} timg_dev_t;
+extern timg_dev_t TIMERG0, TIMERG1;
+
+typedef void *intr_handle_t;
+
+inline int timer_init(timer_group_t, timer_idx_t, const timer_config_t *)
+  { return 0; }
+inline int timer_set_counter_value(timer_group_t, timer_idx_t, uint64_t)
+  { return 0; }
+inline int timer_set_alarm_value(timer_group_t, timer_idx_t, uint64_t)
+  { return 0; }
+inline int timer_enable_intr(timer_group_t, timer_idx_t) { return 0; }
+inline int timer_disable_intr(timer_group_t, timer_idx_t) { return 0; }
+
+int timer_start(timer_group_t group, timer_idx_t timer);
+int timer_pause(timer_group_t group, timer_idx_t timer);
+int timer_isr_register(timer_group_t group, timer_idx_t timer,
+  void (*fn)(void *), void *arg, int flags, intr_handle_t *handle);
+
+#endif // _HOST_DRIVER_TIMER_H_
@@ -0,0 +1,10 @@
+// Host stand-in for the GPIO matrix ROM functions.
+
+#ifndef _HOST_ROM_GPIO_H_
+#define _HOST_ROM_GPIO_H_
+
+#include <stdint.h>
+
+inline void gpio_matrix_out(uint32_t, uint32_t, bool, bool) { }
+
+#endif // _HOST_ROM_GPIO_H_
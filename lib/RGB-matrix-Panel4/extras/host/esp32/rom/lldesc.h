@@ -0,0 +1,18 @@
+// Host stand-in for the DMA descriptor layout.
+
+#ifndef _HOST_ROM_LLDESC_H_
+#define _HOST_ROM_LLDESC_H_
+
+#include <stdint.h>
+
+typedef struct lldesc_s {
+  volatile uint32_t size : 12, length : 12, offset : 5, sosf : 1, eof : 1,
+                    owner : 1;
+  volatile uint8_t *buf;
+  union {
+    volatile uint32_t empty;
+    struct { struct lldesc_s *stqe_next; } qe;
+  };
+} lldesc_t;
+
+#endif // _HOST_ROM_LLDESC_H_
@@ -0,0 +1,13 @@
+// Host stand-in: every heap is DMA capable.
+
+#ifndef _HOST_ESP_HEAP_CAPS_H_
+#define _HOST_ESP_HEAP_CAPS_H_
+
+#include <stdlib.h>
+
+#define MALLOC_CAP_DMA 0
+
+inline void *heap_caps_malloc(size_t size, int) { return malloc(size); }
+inline void  heap_caps_free(void *ptr) { free(ptr); }
+
+#endif // _HOST_ESP_HEAP_CAPS_H_
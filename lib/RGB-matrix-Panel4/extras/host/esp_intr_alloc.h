@@ -0,0 +1,16 @@
+// Host stand-in for interrupt allocation, see driver/timer.h.
+
+#ifndef _HOST_ESP_INTR_ALLOC_H_
+#define _HOST_ESP_INTR_ALLOC_H_
+
+#define ESP_INTR_FLAG_IRAM   0x400
+#define ETS_I2S1_INTR_SOURCE 33
+
+typedef void *intr_handle_t;
+
+// Interrupt sources other than timers are never raised
+inline int esp_intr_alloc(int, int, void (*)(void *), void *,
+  intr_handle_t *handle) { if(handle) *handle = NULL; return 0; }
+int esp_intr_free(intr_handle_t handle);
+
+#endif // _HOST_ESP_INTR_ALLOC_H_
@@ -0,0 +1,23 @@
+// Host stand-in for FreeRTOS: one thread, so critical sections are no-ops.
+
+#ifndef _HOST_FREERTOS_H_
+#define _HOST_FREERTOS_H_
+
+typedef int   portMUX_TYPE;
+typedef int   BaseType_t;
+typedef void *TaskHandle_t;
+
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define pdFALSE 0
+#define pdTRUE  1
+
+#define portENTER_CRITICAL(mux)     ((void)(mux))
+#define portEXIT_CRITICAL(mux)      ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux) ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux)  ((void)(mux))
+#define portYIELD_FROM_ISR()        ((void)0)
+
+inline void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t *woken)
+  { *woken = pdFALSE; }
+
+#endif // _HOST_FREERTOS_H_
@@ -0,0 +1 @@
+// Host stand-in, see freertos/FreeRTOS.h.
@@ -0,0 +1,94 @@
+// THIS IS NOT ARDUINO CODE -- DON'T INCLUDE IN YOUR SKETCH.  Runtime
+// behind the stand-in headers in this directory, so RGBmatrixPanel4 can
+// run natively (see matrixsim.cpp).  Interrupts are simulated: timer
+// handlers registered with timer_isr_register() run from delay(), each as
+// often as a whole refresh cycle needs per simulated millisecond.
+
+#include "Arduino.h"
+#include "driver/timer.h"
+#include "driver/gpio.h"
+#include "soc/i2s_struct.h"
+#include "esp_intr_alloc.h"
+#include "xtensa/hal.h"
+#include <chrono>
+
+#define HOST_TIMERS      (TIMER_GROUP_MAX * TIMER_MAX)
+#define HOST_ISR_PER_MS  256 // 16 rows * 8 planes, twice
+
+volatile uint32_t host_port[64];
+HostSerial        Serial;
+timg_dev_t        TIMERG0, TIMERG1;
+gpio_dev_t        GPIO;
+i2s_dev_t         I2S1;
+uint32_t          GPIO_PIN_MUX_REG[64];
+
+static struct {
+  void (*fn)(void *);
+  void  *arg;
+  bool   running;
+} timers[HOST_TIMERS];
+
+static unsigned long now_ms;
+
+int timer_isr_register(timer_group_t group, timer_idx_t timer,
+  void (*fn)(void *), void *arg, int flags, intr_handle_t *handle)
+{
+  int t = group * TIMER_MAX + timer;
+
+  (void)flags;
+  timers[t].fn  = fn;
+  timers[t].arg = arg;
+  // Handle is the slot + 1, so it is never NULL
+  if(handle) *handle = (intr_handle_t)(intptr_t)(t + 1);
+  return 0;
+}
+
+int esp_intr_free(intr_handle_t handle)
+{
+  intptr_t t = (intptr_t)handle - 1;
+
+  if((t >= 0) && (t < HOST_TIMERS)) timers[t].fn = NULL;
+  return 0;
+}
+
+int timer_start(timer_group_t group, timer_idx_t timer)
+{
+  timers[group * TIMER_MAX + timer].running = true;
+  return 0;
+}
+
+int timer_pause(timer_group_t group, timer_idx_t timer)
+{
+  timers[group * TIMER_MAX + timer].running = false;
+  return 0;
+}
+
+void delay(unsigned long ms)
+{
+  for(unsigned long i = 0; i < ms * HOST_ISR_PER_MS; i++)
+  {
+    for(int t = 0; t < HOST_TIMERS; t++)
+    {
+      if(timers[t].fn && timers[t].running) timers[t].fn(timers[t].arg);
+    }
+  }
+  now_ms += ms;
+}
+
+unsigned long millis(void)
+{
+  return now_ms;
+}
+
+unsigned long micros(void)
+{
+  return now_ms * 1000;
+}
+
+uint32_t xthal_get_ccount(void)
+{
+  using namespace std::chrono;
+  return (uint32_t)(duration_cast<nanoseconds>(
+    steady_clock::now().time_since_epoch()).count() *
+    getCpuFrequencyMhz() / 1000);
+}
@@ -0,0 +1,80 @@
+// THIS IS NOT ARDUINO CODE -- DON'T INCLUDE IN YOUR SKETCH.  It's a
+// command-line tool that turns a binary PPM (P6) holding the frames of an
+// animation one below the other into a file for RGBmatrixAnimation, to
+// put on SPIFFS (the data/ directory, "Upload Filesystem Image") and
+// play from there.  From this directory, with Adafruit GFX checked out in
+// $GFX, as one command:
+//
+//   g++ -O2 -DARDUINO=10800 -DARDUINO_ARCH_ESP32 -D__xtensa__
+//     -I. -I../.. -I$GFX matrixanim.cpp host.cpp ../../*.cpp
+//     $GFX/Adafruit_GFX.cpp -o matrixanim
+//
+//   matrixanim frames.ppm out.anim [ms [panels [32x32]]]
+//
+// The PPM is as wide as the display; milliseconds per frame default to
+// 40, then as matrixsim.cpp: number of chained panels (default 2), 1 for
+// 32x32 panels instead of 16x32.  The color depth is the library's
+// (RGBMATRIX_PLANES), so build with the sketch's setting.
+
+#include "RGBmatrixPanel4.h"
+#include "matrixanim.h"
+
+int main(int argc, char *argv[])
+{
+	uint16_t ms = 40;
+	uint8_t  panels = 2, tall = 0;
+	int      w, h, max;
+	FILE    *f;
+
+	if(argc > 3) ms     = atoi(argv[3]);
+	if(argc > 4) panels = atoi(argv[4]);
+	if(argc > 5) tall   = atoi(argv[5]);
+	if((argc < 3) || !panels) {
+		(void)fprintf(stderr,
+		  "usage: %s frames.ppm out.anim [ms [panels [32x32]]]\n", argv[0]);
+		return 2;
+	}
+
+	// Pin numbers only matter on the target
+	RGBmatrixPanel4 *matrix = tall ?
+	  new RGBmatrixPanel4(26, 4, 27, 2, 14, 15, 13, false, panels) :
+	  new RGBmatrixPanel4(26, 4, 27,    14, 15, 13, false, panels);
+	int16_t width = matrix->width(), height = matrix->height();
+
+	if(!(f = fopen(argv[1], "rb"))) {
+		perror(argv[1]);
+		return 2;
+	}
+	if((fscanf(f, "P6 %d %d %d", &w, &h, &max) != 3) || (fgetc(f) < 0) ||
+	   (max != 255) || (w != width) || !h || (h % height)) {
+		(void)fprintf(stderr, "%s: not a %dx%d by n frame, 8-bit P6 PPM\n",
+		  argv[1], width, height);
+		return 2;
+	}
+
+	AnimEncoder encoder(*matrix, ms);
+	uint16_t   *image = (uint16_t *)malloc(width * height * sizeof(uint16_t));
+	for(int n = h / height; n; n--) {
+		for(int i = 0; i < width * height; i++) {
+			uint8_t r = fgetc(f), g = fgetc(f), b = fgetc(f);
+			image[i] = matrix->Color888(r, g, b, true);
+		}
+		matrix->drawRGBBitmap(0, 0, image, width, height);
+		encoder.add();
+	}
+	if(feof(f)) {
+		(void)fprintf(stderr, "%s: file is short\n", argv[1]);
+		return 2;
+	}
+	(void)fclose(f);
+
+	if(!(f = fopen(argv[2], "wb")) ||
+	   (fwrite(encoder.data.data(), 1, encoder.data.size(), f) !=
+	    encoder.data.size()) || fclose(f)) {
+		perror(argv[2]);
+		return 2;
+	}
+	(void)printf("%d frames, %lu bytes\n", h / height,
+	  (unsigned long)encoder.data.size());
+	return 0;
+}
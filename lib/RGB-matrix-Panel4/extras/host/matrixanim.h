@@ -0,0 +1,94 @@
+// THIS IS NOT ARDUINO CODE -- DON'T INCLUDE IN YOUR SKETCH.  Encoder for
+// the files RGBmatrixAnimation plays (see RGBmatrixAnimation.h), shared by
+// matrixanim.cpp and matrixbench.cpp.  Frames are drawn into a matrix
+// with the stand-ins in this directory, then compared with the one before
+// byte by byte, in the frame buffer's own layout.
+
+#ifndef _HOST_MATRIXANIM_H_
+#define _HOST_MATRIXANIM_H_
+
+#include "RGBmatrixPanel4.h"
+#include <vector>
+
+// Unchanged bytes between two changes that are stored rather than
+// skipped: both cost about as much, and one op is quicker to play
+#define ANIM_GAP 2
+
+class AnimEncoder {
+ public:
+  // Starts from a blank screen, as playback does
+  AnimEncoder(RGBmatrixPanel4 &m, uint16_t ms) : matrix(m), frames(0) {
+    RGBmatrixBitstream b;
+    matrix.getBitstream(&b);
+    uint16_t rowbytes = b.planebytes * b.stride;
+    size = (uint32_t)b.nrows * rowbytes;
+    const uint8_t header[] = { 'R', 'M', 'A', '1', b.nplanes, b.planebytes,
+      b.nrows, 0, (uint8_t)rowbytes, (uint8_t)(rowbytes >> 8), 0, 0,
+      (uint8_t)ms, (uint8_t)(ms >> 8) };
+    data.assign(header, header + sizeof(header));
+    matrix.fillScreen(0);
+    prev.assign(matrix.backBuffer(), matrix.backBuffer() + size);
+  }
+
+  // Add what's been drawn into the matrix's back buffer as the next frame
+  void add(void) {
+    const uint8_t *cur = matrix.backBuffer();
+    uint32_t       pos = 0, i, j, k;
+
+    for(;;) {
+      for(i = pos; (i < size) && (cur[i] == prev[i]); i++);
+      if(i == size) break;
+      // Changes from i to j, taking in short unchanged gaps
+      for(j = i; ; j = k) {
+        for(; (j < size) && (cur[j] != prev[j]); j++);
+        for(k = j; (k < size) && (k - j <= ANIM_GAP) && (cur[k] == prev[k]);
+          k++);
+        if((k == size) || (k - j > ANIM_GAP)) break;
+      }
+      if(i > pos) varint((i - pos) << 1);
+      varint(((j - i) << 1) | 1);
+      data.insert(data.end(), &cur[i], &cur[j]);
+      pos = j;
+    }
+    varint(0);
+    prev.assign(cur, cur + size);
+    frames++;
+    data[10] = frames;
+    data[11] = frames >> 8;
+  }
+
+  std::vector<uint8_t> data; // The file so far
+
+ private:
+  void varint(uint32_t v) {
+    for(; v >= 0x80; v >>= 7) data.push_back((v & 0x7F) | 0x80);
+    data.push_back(v);
+  }
+
+  RGBmatrixPanel4     &matrix;
+  std::vector<uint8_t> prev;
+  uint32_t             size;
+  uint16_t             frames;
+};
+
+// Plays from memory, for checking and timing the player
+class AnimStream : public Stream {
+ public:
+  AnimStream(const std::vector<uint8_t> &d) : data(d), pos(0) { }
+  int    available(void) { return data.size() - pos; }
+  int    read(void) { return (pos < data.size()) ? data[pos++] : -1; }
+  int    peek(void) { return (pos < data.size()) ? data[pos] : -1; }
+  size_t readBytes(char *buf, size_t n) {
+    if(n > data.size() - pos) n = data.size() - pos;
+    if(n) memcpy(buf, &data[pos], n);
+    pos += n;
+    return n;
+  }
+  void   rewind(void) { pos = 0; }
+
+ private:
+  const std::vector<uint8_t> &data;
+  size_t                      pos;
+};
+
+#endif // _HOST_MATRIXANIM_H_
@@ -0,0 +1,247 @@
+// THIS IS NOT ARDUINO CODE -- DON'T INCLUDE IN YOUR SKETCH.  It's a
+// command-line tool that times RGBmatrixPanel4 drawing and refresh, and
+// the clock's screens (src/screens.cpp, no network involved), natively
+// with the stand-ins in this directory (see matrixsim.cpp).  From the
+// project folder "pio run -e native -t exec" builds and runs it (see
+// [env:native] in platformio.ini); or from this directory, with Adafruit
+// GFX checked out in $GFX, as one command:
+//
+//   g++ -O2 -DARDUINO=10800 -DARDUINO_ARCH_ESP32 -D__xtensa__
+//     -I. -I../.. -I../../../../include -I$GFX matrixbench.cpp host.cpp
+//     ../../*.cpp ../../../../src/screens.cpp $GFX/Adafruit_GFX.cpp
+//     -o matrixbench
+//
+// Every benchmark is run on chains of 1, 2, 4 and 8 16x32 panels, set up
+// as src/main.cpp does.  Output is one JSON object per line, so runs can
+// be kept and compared across commits:
+//
+//   {"bench":"fillScreen","panels":2,"planes":4,"shadow":0,"ops":..,
+//    "ns_per_op":..,"cycles_per_op":..}
+//
+// For "updateDisplay", the banners, "anim/update", the frames and the
+// screens an op is one whole frame.  "updateDisplay/general" is the same
+// refresh through the general shift-out kernel that longer chains use,
+// to compare with the one specialised for 1 to 4 panels.  The "frame" benchmarks include
+// queueing it (requestSwap()), so build with and without
+// -DRGBMATRIX_SHADOW=1 to compare drawing into a shadow framebuffer with
+// drawing straight into the frame buffer (the others leave out packing
+// the shadow, so only compare them within one build).  Cycles are the
+// host's time stamp counter where there is one (x86), otherwise time at
+// getCpuFrequencyMhz(); they compare builds on the same machine, not with
+// the ESP32 (see getStats() for that).  An optional parameter runs only
+// the benchmarks whose name starts with it.
+
+#include "RGBmatrixPanel4.h"
+#include "RGBmatrixAnimation.h"
+#include "screens.h"
+#include "matrixanim.h"
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Left out of the tests in test/ ("pio test -e native" builds this file
+// with them), which bring their own main()
+#ifndef PIO_UNIT_TESTING
+
+#define BENCH_MIN_NS 100000000ULL // Run each benchmark for at least 0.1 s
+
+static const char *only;
+
+// Switches a matrix to the general shift-out kernel and back (see
+// selectShifter()), which only the driver itself otherwise picks
+class RGBmatrixBench {
+ public:
+	static void generalKernel(RGBmatrixPanel4 &m, boolean general) {
+		m.selectShifter(general);
+	}
+};
+
+static uint64_t nanos(void)
+{
+	using namespace std::chrono;
+	return duration_cast<nanoseconds>(
+	  steady_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return nanos() * getCpuFrequencyMhz() / 1000;
+#endif
+}
+
+// Call fn (which does opsPerCall of whatever is being measured) until
+// enough time has passed to trust the average, doubling the count each
+// round so the clock is read rarely.
+template<typename F>
+static void bench(const char *name, uint8_t panels, uint32_t opsPerCall,
+  F fn)
+{
+	uint64_t calls, t0, c0, ns, cyc;
+
+	if(only && strncmp(name, only, strlen(only))) return;
+
+	fn(); // Warm up caches
+	for(calls = 1; ; calls *= 2) {
+		t0 = nanos();
+		c0 = cycles();
+		for(uint64_t i = 0; i < calls; i++) fn();
+		cyc = cycles() - c0;
+		ns  = nanos() - t0;
+		if(ns >= BENCH_MIN_NS) break;
+	}
+
+	double ops = (double)calls * opsPerCall;
+	(void)printf("{\"bench\":\"%s\",\"panels\":%d,\"planes\":%d,"
+	  "\"shadow\":%d,\"ops\":%.0f,\"ns_per_op\":%.2f,"
+	  "\"cycles_per_op\":%.1f}\n", name, panels, RGBMATRIX_PLANES,
+	  RGBMATRIX_SHADOW, ops, ns / ops, cyc / ops);
+	(void)fflush(stdout);
+}
+
+static void run(uint8_t panels)
+{
+	// Pin numbers only matter on the target
+	RGBmatrixPanel4 *matrix = new RGBmatrixPanel4(26, 4, 27, 14, 15, 13,
+	                            RGBMATRIX_TRIPLEBUF, panels);
+	RGBmatrixPanel4 &m = *matrix;
+	int16_t         w  = m.width(), h = m.height();
+
+	m.begin();
+	m.setTextWrap(false);
+
+	uint16_t c = 0;
+	bench("drawPixel", panels, w * h, [&]() {
+		for(int16_t y = 0; y < h; y++)
+			for(int16_t x = 0; x < w; x++) m.drawPixel(x, y, c++);
+	});
+	bench("fillScreen", panels, 1, [&]() { m.fillScreen(c++); });
+
+	// A whole-screen picture: a few colors in runs, as icons mostly are
+	uint16_t *image = (uint16_t *)malloc(w * h * sizeof(uint16_t));
+	for(int16_t y = 0; y < h; y++)
+		for(int16_t x = 0; x < w; x++)
+			image[y * w + x] = m.Color333(x / 8 & 7, y / 4 & 7, (x + y) / 16 & 7);
+	bench("drawRGBBitmap", panels, w * h, [&]() {
+		m.drawRGBBitmap(0, 0, image, w, h);
+	});
+	free(image);
+
+	const char *text = "12:34:56 Wednesday";
+	bench("print", panels, strlen(text), [&]() {
+		m.setCursor(0, 0);
+		m.print(text);
+	});
+
+	// Whole frames, cleared, drawn and queued: two lines of text across
+	// the display, and a few solid blocks over a colored background
+	bench("frame/text", panels, 1, [&]() {
+		m.fillScreen(0);
+		m.setTextColor(0xFFFF);
+		for(int16_t y = 0; y < h; y += 8) {
+			m.setCursor(0, y);
+			for(int16_t x = 0; x < w; x += 6) m.write('0' + (x + y) % 75);
+		}
+		m.requestSwap();
+	});
+	bench("frame/fill", panels, 1, [&]() {
+		m.fillScreen(0x001F);
+		m.fillRect(0, 0, w / 2, h / 2, 0xF800);
+		m.fillRect(w / 2, h / 2, w / 2, h / 2, 0x07E0);
+		m.fillRect(w / 4, h / 4, w / 2, h / 2, 0xFFE0);
+		m.requestSwap();
+	});
+
+	// Worst case for the copy: every row changed
+	bench("swapBuffers", panels, 1, [&]() {
+		m.markDirty(0xFFFFFFFF);
+		m.swapBuffers(true);
+	});
+
+	// A banner several displays long, one frame of it halfway through:
+	// printed, and shown from a strip printed once (drawScroll())
+	const char *banner = "Light rain and a moderate breeze this afternoon, "
+	                     "clearing from the west by evening";
+	GFXcanvas1 strip(strlen(banner) * 6, 8);
+	strip.setTextWrap(false);
+	strip.print(banner);
+	bench("banner/print", panels, 1, [&]() {
+		m.setCursor(-strip.width() / 2, 1);
+		m.print(banner);
+	});
+	bench("banner/drawScroll", panels, 1, [&]() {
+		m.drawScroll(&strip, 1, strip.width() / 2, c, c);
+	});
+
+	// The banner scrolling a pixel a frame, played back as an animation
+	// (RGBmatrixAnimation) from memory
+	AnimEncoder encoder(m, 0);
+	for(int16_t x = 0; x < 32; x++) {
+		m.drawScroll(&strip, 1, strip.width() / 2 + x, 0xFFFF, 0);
+		encoder.add();
+	}
+	AnimStream         stream(encoder.data);
+	RGBmatrixAnimation anim(m);
+	bench("anim/update", panels, 1, [&]() {
+		if(!anim.update()) {
+			stream.rewind();
+			anim.begin(stream);
+			anim.update();
+		}
+	});
+
+	RGBmatrixBitstream bitstream;
+	m.getBitstream(&bitstream);
+	bench("updateDisplay", panels, 1, [&]() {
+		for(uint16_t i = bitstream.nrows * bitstream.nplanes; i; i--)
+			m.updateDisplay();
+	});
+	if(panels <= 4) { // Longer chains use the general kernel anyway
+		RGBmatrixBench::generalKernel(m, true);
+		bench("updateDisplay/general", panels, 1, [&]() {
+			for(uint16_t i = bitstream.nrows * bitstream.nplanes; i; i--)
+				m.updateDisplay();
+		});
+		RGBmatrixBench::generalKernel(m, false);
+	}
+
+	// The screens as loop() draws them, one frame per call; banners scroll
+	textX = w;
+	bench("screen/time", panels, 1, [&]() {
+		m.fillScreen(0);
+		drawTime(m, 12, 34, 56.7, "Wednesday");
+	});
+	bench("screen/twitter", panels, 1, [&]() {
+		m.fillScreen(0);
+		drawTwitter(m, 12345);
+	});
+	bench("screen/youtube", panels, 1, [&]() {
+		m.fillScreen(0);
+		drawYoutube(m, "1234567");
+	});
+	bench("screen/weather", panels, 1, [&]() {
+		m.fillScreen(0);
+		drawWeather(m, "Aberystwyth", 14, "10d");
+	});
+	bench("screen/crypto", panels, 1, [&]() {
+		m.fillScreen(0);
+		drawCrypto(m, "Bitcoin", 28123.45, -1.23);
+	});
+
+	m.end();
+	delete matrix;
+}
+
+int main(int argc, char *argv[])
+{
+	static const uint8_t panels[] = { 1, 2, 4, 8 };
+
+	if(argc > 1) only = argv[1];
+	for(uint8_t i = 0; i < sizeof(panels); i++) run(panels[i]);
+	return 0;
+}
+
+#endif // PIO_UNIT_TESTING
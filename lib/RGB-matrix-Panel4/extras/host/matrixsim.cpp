@@ -0,0 +1,114 @@
+// THIS IS NOT ARDUINO CODE -- DON'T INCLUDE IN YOUR SKETCH.  It's a
+// command-line tool that runs RGBmatrixPanel4 natively with the GPIO and
+// timer layer stubbed out (the other files in this directory), draws a
+// test screen and renders what the panels would show as PPM images:
+//
+//   matrix-buffer.ppm  read back from the frame buffer (getPixel())
+//   matrix-pins.ppm    decoded from the pin sequence the ESP32 refresh
+//                      produces for that buffer (RGBmatrixBitstream)
+//
+// Both should be identical; the exit status is 1 if they are not.  The
+// ESP32 code paths are the ones built.  From this directory, with
+// Adafruit GFX checked out in $GFX, as one command:
+//
+//   g++ -O2 -DARDUINO=10800 -DARDUINO_ARCH_ESP32 -D__xtensa__
+//     -I. -I../.. -I$GFX matrixsim.cpp host.cpp ../../*.cpp
+//     $GFX/Adafruit_GFX.cpp -o matrixsim
+//
+// Optional parameters: number of chained panels (default 2), 1 for
+// 32x32 panels instead of 16x32, pixel size of the output (default 8)
+// and text to show.
+
+#include "RGBmatrixPanel4.h"
+
+static int writePPM(RGBmatrixPanel4 &matrix, const uint8_t *frame,
+  uint8_t zoom, const char *name)
+{
+	int16_t w = matrix.width(), h = matrix.height();
+	FILE   *f;
+
+	if(!(f = fopen(name, "wb"))) {
+		perror(name);
+		return -1;
+	}
+	(void)fprintf(f, "P6\n%d %d\n255\n", w * zoom, h * zoom);
+	for(int y = 0; y < h * zoom; y++) {
+		for(int x = 0; x < w * zoom; x++) {
+			uint16_t c = 0;
+			// Leave a dark line between LEDs if they're big enough
+			if((zoom < 4) || ((x % zoom) && (y % zoom)))
+				c = matrix.getPixel(x / zoom, y / zoom, frame);
+			(void)fputc(((c >> 11) & 0x1F) * 255 / 31, f);
+			(void)fputc(((c >>  5) & 0x3F) * 255 / 63, f);
+			(void)fputc(( c        & 0x1F) * 255 / 31, f);
+		}
+	}
+	return fclose(f);
+}
+
+int main(int argc, char *argv[])
+{
+	uint8_t     panels = 2, tall = 0, zoom = 8;
+	const char *text   = "12:34";
+
+	if(argc > 1) panels = atoi(argv[1]);
+	if(argc > 2) tall   = atoi(argv[2]);
+	if(argc > 3) zoom   = atoi(argv[3]);
+	if(argc > 4) text   = argv[4];
+	if(!panels || !zoom) {
+		(void)fprintf(stderr,
+		  "usage: %s [panels [32x32 [zoom [text]]]]\n", argv[0]);
+		return 2;
+	}
+
+	// Pin numbers only matter on the target
+	RGBmatrixPanel4 *matrix = tall ?
+	  new RGBmatrixPanel4(26, 4, 27, 2, 14, 15, 13, false, panels) :
+	  new RGBmatrixPanel4(26, 4, 27,    14, 15, 13, false, panels);
+	matrix->begin();
+
+	// Something of everything: all hues at full and partial brightness,
+	// a gradient through every level and text
+	int16_t w = matrix->width(), h = matrix->height();
+	for(int16_t x = 0; x < w; x++) {
+		uint8_t hue = x * 6 / w;
+		matrix->drawFastVLine(x, 0, h / 4,
+		  matrix->Color333(hue & 1 ? 7 : 0, hue & 2 ? 7 : 0, hue & 4 ? 7 : 0));
+		matrix->drawPixel(x, h / 4, matrix->Color888(x * 255 / (w - 1),
+		  255 - x * 255 / (w - 1), (x & 1) * 128, true));
+	}
+	matrix->setTextColor(matrix->Color444(15, 15, 15));
+	matrix->setCursor(1, h / 4 + 2);
+	matrix->print(text);
+
+	RGBmatrixBitstream bitstream;
+	const uint8_t     *buffer = matrix->backBuffer();
+	matrix->getBitstream(&bitstream);
+
+	size_t    n       = bitstream.generate(buffer, NULL, 0);
+	uint16_t *samples = (uint16_t *)malloc(n * sizeof(uint16_t));
+	uint8_t  *frame   = (uint8_t *)malloc((uint32_t)bitstream.nrows *
+	                      bitstream.nplanes * bitstream.stride);
+	if(!samples || !frame) {
+		(void)fprintf(stderr, "out of memory\n");
+		return 2;
+	}
+	bitstream.generate(buffer, samples, n);
+	bitstream.decode(samples, n, frame);
+
+	if(writePPM(*matrix, NULL, zoom, "matrix-buffer.ppm") ||
+	   writePPM(*matrix, frame, zoom, "matrix-pins.ppm"))
+		return 2;
+
+	(void)printf("%dx%d, %lu samples per refresh\n", w, h, (unsigned long)n);
+	for(int16_t y = 0; y < h; y++) {
+		for(int16_t x = 0; x < w; x++) {
+			if(matrix->getPixel(x, y) != matrix->getPixel(x, y, frame)) {
+				(void)printf("pixel %d,%d differs: buffer %04X, pins %04X\n",
+				  x, y, matrix->getPixel(x, y), matrix->getPixel(x, y, frame));
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
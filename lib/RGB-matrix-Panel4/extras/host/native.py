@@ -0,0 +1,14 @@
+# PlatformIO extra script for the project's [env:native].  Adafruit GFX's
+# SPI and I2C display classes need the Arduino SPI and Wire libraries,
+# which have no stand-ins here (and nothing on the host uses them), so
+# they're left out of the build.
+
+Import("env")
+
+
+def skip(node):
+    return None
+
+
+for name in ("Adafruit_SPITFT.cpp", "Adafruit_GrayOLED.cpp"):
+    env.AddBuildMiddleware(skip, "*/" + name)
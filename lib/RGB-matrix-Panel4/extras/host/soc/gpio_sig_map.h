@@ -0,0 +1,9 @@
+// Host stand-in for the GPIO matrix signal numbers.
+
+#ifndef _HOST_SOC_GPIO_SIG_MAP_H_
+#define _HOST_SOC_GPIO_SIG_MAP_H_
+
+#define I2S1O_DATA_OUT8_IDX 174
+#define SIG_GPIO_OUT_IDX    256
+
+#endif // _HOST_SOC_GPIO_SIG_MAP_H_
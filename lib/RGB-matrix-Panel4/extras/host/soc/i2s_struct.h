@@ -0,0 +1,29 @@
+// Host stand-in for the I2S register block, fields as beginDMA() uses
+// them.  Nothing reads it back, so DMA mode sets up but never runs.
+
+#ifndef _HOST_SOC_I2S_STRUCT_H_
+#define _HOST_SOC_I2S_STRUCT_H_
+
+#include <stdint.h>
+
+typedef struct {
+  struct { uint32_t tx_reset, tx_fifo_reset, tx_right_first, tx_start; } conf;
+  struct { uint32_t val, lcd_en, lcd_tx_wrx2_en; } conf2;
+  struct { uint32_t val, tx_bits_mod, tx_bck_div_num; } sample_rate_conf;
+  struct {
+    uint32_t val, clka_en, clkm_div_a, clkm_div_b, clkm_div_num;
+  } clkm_conf;
+  struct {
+    uint32_t val, tx_fifo_mod_force_en, tx_fifo_mod, tx_data_num, dscr_en;
+  } fifo_conf;
+  struct { uint32_t val, tx_stop_en, tx_pcm_bypass; } conf1;
+  struct { uint32_t val, tx_chan_mod; } conf_chan;
+  struct { uint32_t val; } timing;
+  struct { uint32_t val, out_rst, ahbm_rst, out_eof_mode; } lc_conf;
+  struct { uint32_t val, out_eof; } int_clr, int_ena, int_st;
+  struct { uint32_t addr, stop, start; } out_link;
+  uint32_t out_eof_des_addr;
+} i2s_dev_t;
+extern i2s_dev_t I2S1;
+
+#endif // _HOST_SOC_I2S_STRUCT_H_
@@ -0,0 +1,11 @@
+// Host stand-in for the CPU cycle counter, derived from the host's clock
+// at getCpuFrequencyMhz().
+
+#ifndef _HOST_XTENSA_HAL_H_
+#define _HOST_XTENSA_HAL_H_
+
+#include <stdint.h>
+
+uint32_t xthal_get_ccount(void);
+
+#endif // _HOST_XTENSA_HAL_H_
@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+# THIS IS NOT ARDUINO CODE -- DON'T INCLUDE IN YOUR SKETCH.  It's a
+# command-line tool that converts PNG images into an RGBmatrixAtlas (see
+# RGBmatrixPanel4.h) and outputs it as a header file to stdout; include
+# that in the sketch and draw its images with drawImage():
+#
+#   png2atlas.py icons sun.png cloud.png > icons.h
+#
+# gives 'icons' (the atlas) and ICONS_SUN, ICONS_CLOUD (image indices,
+# from the file names).  The palette, image data and entries go in
+# PROGMEM; 'icons' itself is a small struct in RAM.  Colors are taken to
+# 5/6/5, pixels less than half opaque are transparent.  Only Python's
+# standard library is needed.
+
+import os
+import re
+import struct
+import sys
+import zlib
+
+
+def read_png(path):
+    """Return width, height and rows of (r, g, b, a) tuples."""
+    with open(path, 'rb') as f:
+        data = f.read()
+    if data[:8] != b'\x89PNG\r\n\x1a\n':
+        raise ValueError('not a PNG file')
+
+    pos, idat, palette, trns = 8, b'', [], b''
+    while pos < len(data):
+        length, kind = struct.unpack('>I4s', data[pos:pos + 8])
+        body = data[pos + 8:pos + 8 + length]
+        pos += length + 12
+        if kind == b'IHDR':
+            width, height, depth, ctype, _, _, interlace = \
+                struct.unpack('>IIBBBBB', body)
+        elif kind == b'PLTE':
+            palette = [tuple(body[i:i + 3]) for i in range(0, length, 3)]
+        elif kind == b'tRNS':
+            trns = body
+        elif kind == b'IDAT':
+            idat += body
+        elif kind == b'IEND':
+            break
+    if interlace:
+        raise ValueError('interlaced PNGs are not supported')
+    channels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}[ctype]
+    if depth > 8 or (depth < 8 and ctype not in (0, 3)):
+        raise ValueError('unsupported bit depth')
+
+    # Undo the per-row filters, on whole bytes
+    bpp = max(1, channels * depth // 8)
+    stride = (width * channels * depth + 7) // 8
+    raw = zlib.decompress(idat)
+    rows, prev = [], bytearray(stride)
+    for y in range(height):
+        kind = raw[y * (stride + 1)]
+        line = bytearray(raw[y * (stride + 1) + 1:(y + 1) * (stride + 1)])
+        for i in range(stride):
+            a = line[i - bpp] if i >= bpp else 0
+            b = prev[i]
+            c = prev[i - bpp] if i >= bpp else 0
+            if kind == 1:
+                line[i] = (line[i] + a) & 0xFF
+            elif kind == 2:
+                line[i] = (line[i] + b) & 0xFF
+            elif kind == 3:
+                line[i] = (line[i] + (a + b) // 2) & 0xFF
+            elif kind == 4:
+                p = a + b - c
+                pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+                pred = a if pa <= pb and pa <= pc else b if pb <= pc else c
+                line[i] = (line[i] + pred) & 0xFF
+        rows.append(line)
+        prev = line
+
+    # Samples to RGBA
+    out = []
+    for line in rows:
+        if depth < 8:
+            per = 8 // depth
+            samples = [(line[i // per] >> (8 - depth * (i % per + 1))) &
+                       ((1 << depth) - 1) for i in range(width)]
+        else:
+            samples = list(line)
+        pixels = []
+        for x in range(width):
+            s = samples[x * channels:(x + 1) * channels]
+            if ctype == 3:
+                r, g, b = palette[s[0]]
+                a = trns[s[0]] if s[0] < len(trns) else 255
+            elif ctype in (0, 4):
+                v = s[0] * 255 // ((1 << depth) - 1)
+                r = g = b = v
+                a = s[1] if ctype == 4 else 255
+                if ctype == 0 and len(trns) == 2 and \
+                        s[0] == struct.unpack('>H', trns)[0]:
+                    a = 0
+            else:
+                r, g, b = s[:3]
+                a = s[3] if ctype == 6 else 255
+                if ctype == 2 and len(trns) == 6 and \
+                        (r, g, b) == struct.unpack('>HHH', trns):
+                    a = 0
+            pixels.append((r, g, b, a))
+        out.append(pixels)
+    return width, height, out
+
+
+def encode(rows, palette):
+    """Run-length code an image's rows, adding its colors to palette."""
+    pixels = []
+    for line in rows:
+        for r, g, b, a in line:
+            if a < 128:
+                pixels.append(None)
+            else:
+                c = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3)
+                if c not in palette:
+                    if len(palette) == 256:
+                        raise ValueError('more than 256 colors in the atlas')
+                    palette.append(c)
+                pixels.append(palette.index(c))
+    runs, i = bytearray(), 0
+    while i < len(pixels):
+        n = 1
+        while n < 128 and i + n < len(pixels) and pixels[i + n] == pixels[i]:
+            n += 1
+        if pixels[i] is None:
+            runs.append(n - 1)
+        else:
+            runs += bytes((0x80 | (n - 1), pixels[i]))
+        i += n
+    return runs
+
+
+def main(argv):
+    if len(argv) < 3:
+        sys.stderr.write('usage: %s name image.png...\n' % argv[0])
+        return 2
+    name, palette, data, entries = argv[1], [], bytearray(), []
+    for path in argv[2:]:
+        width, height, rows = read_png(path)
+        if width > 255 or height > 255:
+            raise ValueError('%s: images are at most 255x255' % path)
+        entries.append((path, width, height, len(data)))
+        data += encode(rows, palette)
+
+    def table(values, fmt, per):
+        lines = []
+        for i in range(0, len(values), per):
+            lines.append('  ' + ', '.join(fmt % v for v in values[i:i + per]))
+        return ',\n'.join(lines)
+
+    guard = name.upper() + '_H'
+    out = sys.stdout
+    out.write('// Generated by png2atlas.py from %s -- don\'t edit.\n\n' %
+              ', '.join(os.path.basename(e[0]) for e in entries))
+    out.write('#ifndef %s\n#define %s\n\n' % (guard, guard))
+    out.write('#include <RGBmatrixPanel4.h>\n\n')
+    for i, e in enumerate(entries):
+        base = os.path.splitext(os.path.basename(e[0]))[0]
+        out.write('#define %s_%s %d // %dx%d\n' % (name.upper(),
+                  re.sub(r'\W', '_', base).upper(), i, e[1], e[2]))
+    out.write('\nstatic const uint16_t %s_palette[] PROGMEM = {\n%s\n};\n\n'
+              % (name, table(palette, '0x%04X', 8)))
+    out.write('static const uint8_t %s_data[] PROGMEM = { // %d bytes\n%s\n};'
+              '\n\n' % (name, len(data), table(list(data), '0x%02X', 12)))
+    out.write('static const RGBmatrixAtlasEntry %s_entries[] PROGMEM = {\n%s\n'
+              '};\n\n' % (name, ',\n'.join('  { %d, %d, %d }' % e[1:]
+                                             for e in entries)))
+    out.write('// In RAM, drawImage() reads it directly; the tables are PROGMEM\n')
+    out.write('static const RGBmatrixAtlas %s = {\n  %s_palette, %s_data, '
+              '%s_entries, %d\n};\n\n#endif // %s\n' %
+              (name, name, name, name, len(entries), guard))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
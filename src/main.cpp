@@ -10,6 +10,8 @@
 #include <time.h>
 #include <SPIFFS.h>          //SPIFFS FILE SYSTEM
 #include <RGBmatrixPanel4.h> //Adafruit Libraru for RGB Matrix Panel
+#include <RGBmatrixAnimation.h> //Plays animations from SPIFFS straight into the matrix buffer
+#include "screens.h"         //Drawing of each screen, kept apart from the network code.
 
 AsyncWebServer server(80); //Setup server. Port 80 for normal HTTP.
 
@@ -21,10 +23,10 @@ AsyncWebServer server(80); //Setup server. Port 80 for normal HTTP.
 #define B 4
 #define C 27
 
-RGBmatrixPanel4 matrix(A, B, C, CLK, LAT, OE, true, 2); //Initializer for Matrix - 'true' enables double buffering and '2' doubles the width of the panel from 32 to 64.
+RGBmatrixPanel4 matrix(A, B, C, CLK, LAT, OE, RGBMATRIX_TRIPLEBUF, 2); //Initializer for Matrix - RGBMATRIX_TRIPLEBUF enables triple buffering (always a free buffer to draw into) and '2' doubles the width of the panel from 32 to 64.
 
-int16_t textX = matrix.width(), //Create textX, a variable which will hold the horizontal cursor positon so text can scroll accross the matrix.
-        textMin = 0; //TextMin is used to determine the length of which the text will scroll across the screen before returning to the original textX position of matrix.width().
+RGBmatrixAnimation transition(matrix); //Wipe played between screens, made with lib/RGB-matrix-Panel4/extras/host/matrixanim.cpp
+File transitionFile; //Kept open while the wipe plays, it is read a frame at a time.
 
 //Button Connector Setup
 #define BLEFT 34
@@ -112,33 +114,7 @@ void clearWifi() //WifiManager method for debug, clear saved Wifi Networks
 
 void printTime() //Function to print the time.
 {
-  matrix.fillScreen(0); //0 'clears' the screen.
-  matrix.setTextColor(matrix.Color444(7, 0, 0));
-  matrix.setTextSize(1); //1 is the lowest text size, which takes up 5 spaces accross.
-
-  matrix.setCursor(10, 0); //Where the text will be placed on the matrix. 64, 16 max.
-  if (hours < 10)
-  {
-    matrix.print("0");
-  }
-  matrix.print(hours);
-  matrix.print(":");
-  if (minutes < 10)
-  {
-    matrix.print("0");
-  }
-  matrix.print(minutes);
-  matrix.print(":");
-  if ((int)seconds < 10)
-  {
-    matrix.print("0");
-  }
-  matrix.print((int)seconds); //the float seconds is casted to int to conveniently truncate the decimal for the display.
-
-  matrix.setTextSize(1);
-  matrix.setTextColor(matrix.Color444(0, 7, 0));
-  matrix.setCursor((64 / 2) - (date.length() * 6 / 2), 8); //Calculate the correct placement of the date to centre it.
-  matrix.print(date); //Print the date.
+  drawTime(matrix, hours, minutes, seconds, date);
 }
 
 
@@ -309,19 +285,7 @@ void twitter()
     client.stop(); //Stop the client and clear the data recieved.
   }
 
-  textMin = sizeof("Twitter Followers") * -8;
-  matrix.setTextSize(1);
-  matrix.setTextColor(matrix.Color444(0, 0, 7));
-  matrix.fillScreen(0);
-  matrix.setCursor(textX, 1);
-  matrix.print("Twitter Followers");
-  matrix.setCursor((matrix.width() / 2) - (sizeof(twitterFollowers) * 5 / 2) + (sizeof(twitterFollowers)), 9); //*5 is used as each character is 5 led's accross. The additional sizeOf() is for the 1 led spaces between words.
-  matrix.print(twitterFollowers);
-
-  if ((--textX) < textMin) //This moves the "Twitter Followers" banner along as textX continually updates.
-  {
-    textX = matrix.width();
-  }
+  drawTwitter(matrix, twitterFollowers);
 }
 
 void youtube()
@@ -429,25 +393,14 @@ void youtube()
     client.stop(); //Stop the client and clear the data recieved.
   }
 
-  textMin = sizeof("YouTube Subscribers") * -8;
-  matrix.setTextSize(1);
-  matrix.setTextColor(matrix.Color444(0, 0, 7));
-  matrix.fillScreen(0);
-  matrix.setCursor(textX, 1);
-  matrix.print("YouTube Subscribers");
-  matrix.setCursor((matrix.width() / 2) - (sizeof(subCount) * 5 / 2) + (sizeof(subCount)) , 9); //*5 is used as each character is 5 led's accross. The additional sizeOf() is for the 1 led spaces between words.
-  matrix.print(subCount);
-
-  if ((--textX) < textMin) //This moves the "YouTube Subscribers" banner along as textX continually updates.
-  {
-    textX = matrix.width();
-  }
+  drawYoutube(matrix, subCount);
 }
 
 void weather()
 {
   static unsigned long updateCounter;
   static int main_temp; //Variable declared outside of if statement so it can be accessed later.
+  static char icon[4];  //OpenWeatherMap icon code, e.g. "01d".
 
   if (checkUpdateTime(15, updateCounter) || firstTimeSetup == true)
   {
@@ -555,7 +508,8 @@ void weather()
     JsonObject weather_0 = doc["weather"][0];
     const char *weather_0_main = weather_0["main"]; //TODO: Add Weather Descripton to matrix.
     const char *weather_0_description = weather_0["description"]; 
-    const char *weather_0_icon = weather_0["icon"]; //TODO: Create custom icons using matrix.drawBitmap()     
+    const char *weather_0_icon = weather_0["icon"];
+    snprintf(icon, sizeof(icon), "%s", weather_0_icon ? weather_0_icon : "");
 
     main_temp = doc["main"]["temp"];
 
@@ -568,20 +522,7 @@ void weather()
     client.stop(); //Stop the client and clear the data recieved.
   }
 
-  textMin = -(location.length())*5 - location.length();
-  matrix.setTextSize(1);
-  matrix.setTextColor(matrix.Color444(0, 7, 0));
-  matrix.fillScreen(0);
-  matrix.setCursor(textX, 1);
-  matrix.print(location);
-  matrix.setCursor((matrix.width() / 2) - (sizeof(main_temp) * 5 / 2) + (sizeof(main_temp)), 9);
-  matrix.setTextColor(matrix.Color444(7, 7, 0));
-  matrix.printf("%dc", main_temp); //Special characters like degrees aren't included in the matrix's libary of characters
-
-  if ((--textX) < textMin) //This moves the location banner along as textX continually updates.
-  {
-    textX = matrix.width();
-  }
+  drawWeather(matrix, location, main_temp, icon);
 }
 
 void crypto()
@@ -734,31 +675,7 @@ void crypto()
   }
 
   static int i; //Variable for numerical iterator
-  char priceDiffArrayLength[15];
-  snprintf(priceDiffArrayLength, 15, "%.2lf%% ", priceDiffArray[i]);
-  //priceDiffArray[i] is converted to a formatted char here so the program can use strlen() to get the length of the text.
-
-  textMin = -((nameArray[i]).length())*5 - strlen(priceDiffArrayLength)*5 - nameArray[i].length() - strlen(priceDiffArrayLength); 
-  //textMin is determined by the length of the message, * 5 to account for the length of words and then taken away by the length of the message to account for the 1 led spaces between each letter.
-
-  matrix.setTextSize(1);
-  matrix.setTextColor(matrix.Color444(0, 7, 0));
-  matrix.fillScreen(0);
-  matrix.setCursor(textX, 1);
-  if (priceDiffArray[i] < 0) //If the price difference is below 0, colour switch to red.
-  {
-    matrix.setTextColor(matrix.Color444(7, 0, 0));
-  }
-  matrix.printf("%.2lf%% ", priceDiffArray[i]);
-  matrix.print(nameArray[i]);
-  matrix.setTextColor(matrix.Color444(7, 7, 0));
-  matrix.setCursor((64 / 2) - (sizeof(priceArray[i]) * 6 / 2), 9);
-  matrix.printf("%.2lf", priceArray[i]); //priceArray rendered to 2 significant characters.
-
-  if ((--textX) < textMin) //This moves the location banner along as textX continually updates.
-  {
-    textX = matrix.width();
-  }
+  drawCrypto(matrix, nameArray[i], priceArray[i], priceDiffArray[i]);
 
   if (checkUpdateTime(0.5, screenSwitchCount)) //Small usage of checkUpdateTime that handles switching to the next crypto
   {
@@ -794,6 +711,7 @@ void setup()
   //ACTIVATE LED MATRIX
 
   matrix.begin();
+  textX = matrix.width(); //Banners start just off the right edge.
   matrix.setTextColor(matrix.Color444(7, 0, 0));
   matrix.setTextWrap(false); // Allow text to run off right edge
 
@@ -909,6 +827,25 @@ void setup()
     Serial.println("Wifi Settings Cleared");
     clearWifi();
   });
+
+  server.on("/metrics", HTTP_GET, [](AsyncWebServerRequest *request) { //Refresh statistics of the LED matrix driver, as plain text.
+    RGBmatrixStats stats = matrix.getStats();
+    String metrics;
+    metrics += "matrix_refresh_rate_hz " + String(matrix.refreshRate()) + "\n";
+    metrics += "matrix_frames_total " + String(stats.frames) + "\n";
+    metrics += "matrix_swaps_total " + String(stats.swaps) + "\n";
+    metrics += "matrix_overruns_total " + String(stats.overruns) + "\n";
+    for (int plane = 0; plane < RGBMATRIX_PLANES; plane++) //ISR cost in CPU cycles for each bitplane loaded.
+    {
+      String label = "{plane=\"" + String(plane) + "\"} ";
+      metrics += "matrix_isr_cycles_min" + label + String(stats.isrMin[plane]) + "\n";
+      metrics += "matrix_isr_cycles_max" + label + String(stats.isrMax[plane]) + "\n";
+      metrics += "matrix_isr_cycles_avg" + label + String(stats.isrAvg[plane]) + "\n";
+    }
+    metrics += "matrix_swap_latency_us_max " + String(stats.swapLatencyMax) + "\n";
+    metrics += "matrix_swap_latency_us_avg " + String(stats.swapLatencyAvg) + "\n";
+    request->send(200, "text/plain", metrics);
+  });
 }
 
 /*
@@ -962,6 +899,21 @@ void readButtons()
 
 void loop()
 {
+  if (transition.playing()) //Nothing else is drawn while the wipe plays; update() returns straight away until the next frame is due.
+  {
+    updateClock();
+    if (!transition.update())
+    {
+      transitionFile.close();
+    }
+    return;
+  }
+
+  while (matrix.swapPending()) //Only ever true when double buffered: the last frame is still queued for display in the buffer we are about to draw into.
+  {
+    delay(1);
+  }
+
   matrix.fillScreen(0); //Clear screen at start of every loop.
   updateClock(); //Keep the local clock updating, even in the background of other displays.
 
@@ -996,7 +948,21 @@ void loop()
 #endif
   }
 
-  matrix.swapBuffers(false); //Update Screen
+  if (matrix.dirtyRows()) //Only queue the frame if it differs from the one on display. The clock screen mostly only changes once a second.
+  {
+    matrix.requestSwap(); //Update Screen. Returns straight away, the swap happens at the end of the current refresh while we carry on.
+  }
 
+  int lastMode = displayMode;
   readButtons(); //Search for Button Input to change displayMode.
+
+  if (displayMode != lastMode) //Wipe to the new screen. If the file is missing (or made for another display) the screen just changes.
+  {
+    transitionFile.close();
+    transitionFile = SPIFFS.open("/wipe.anim");
+    if (transitionFile && !transition.begin(transitionFile)) //Not a wipe for this display, don't keep it open.
+    {
+      transitionFile.close();
+    }
+  }
 }
\ No newline at end of file
@@ -0,0 +1,187 @@
+#include "screens.h"
+#include "icons.h" //Made from assets/icons/*.png with lib/RGB-matrix-Panel4/extras/png2atlas.py.
+
+int16_t textX, //Set to matrix.width() in setup() so banners start just off the right edge.
+        textMin = 0;
+
+/*
+|--------------------------------------------------------------------------
+| Clock Screen
+|--------------------------------------------------------------------------
+*/
+
+void drawTime(RGBmatrixPanel4 &matrix, int hours, int minutes, float seconds, const String &date) //Function to print the time.
+{
+  matrix.fillScreen(0); //0 'clears' the screen.
+  matrix.setTextColor(matrix.Color444(7, 0, 0));
+  matrix.setTextSize(1); //1 is the lowest text size, which takes up 5 spaces accross.
+
+  matrix.setCursor(10, 0); //Where the text will be placed on the matrix. 64, 16 max.
+  if (hours < 10)
+  {
+    matrix.print("0");
+  }
+  matrix.print(hours);
+  matrix.print(":");
+  if (minutes < 10)
+  {
+    matrix.print("0");
+  }
+  matrix.print(minutes);
+  matrix.print(":");
+  if ((int)seconds < 10)
+  {
+    matrix.print("0");
+  }
+  matrix.print((int)seconds); //the float seconds is casted to int to conveniently truncate the decimal for the display.
+
+  matrix.setTextSize(1);
+  matrix.setTextColor(matrix.Color444(0, 7, 0));
+  matrix.setCursor((64 / 2) - (date.length() * 6 / 2), 8); //Calculate the correct placement of the date to centre it.
+  matrix.print(date); //Print the date.
+}
+
+/*
+|--------------------------------------------------------------------------
+| Banner Screens
+|--------------------------------------------------------------------------
+| The banner text is printed into a strip once, whenever it changes, and
+| each frame only shows the part of it at textX (see drawScroll()). There is
+| one strip for all the banners, made on first use and kept, so changing the
+| text doesn't touch the heap.
+*/
+
+#define BANNER_CHARS 64 //Longest banner shown; drawCrypto()'s is at most 63, longer locations are cut short.
+
+static void drawBanner(RGBmatrixPanel4 &matrix, const char *text, uint16_t colour)
+{
+  static GFXcanvas1 strip(BANNER_CHARS * 6, 8); //6 led's per character, including the space after it.
+  static char shown[BANNER_CHARS + 1]; //Text and colour the strip currently holds.
+  static uint16_t shownColour;
+
+  if (strncmp(shown, text, BANNER_CHARS) || colour != shownColour)
+  {
+    strncpy(shown, text, BANNER_CHARS);
+    shownColour = colour;
+    strip.fillScreen(0);
+    strip.setTextWrap(false);
+    strip.setCursor(0, 0);
+    strip.print(shown);
+  }
+  matrix.drawScroll(&strip, 1, -textX, colour, colour);
+}
+
+void drawTwitter(RGBmatrixPanel4 &matrix, int twitterFollowers)
+{
+  textMin = sizeof("Twitter Followers") * -8;
+  matrix.setTextSize(1);
+  matrix.setTextColor(matrix.Color444(0, 0, 7));
+  matrix.fillScreen(0);
+  drawBanner(matrix, "Twitter Followers", matrix.Color444(0, 0, 7));
+  matrix.drawImage(&icons, ICONS_TWITTER, 0, 9);
+  matrix.setCursor((matrix.width() / 2) - (sizeof(twitterFollowers) * 5 / 2) + (sizeof(twitterFollowers)), 9); //*5 is used as each character is 5 led's accross. The additional sizeOf() is for the 1 led spaces between words.
+  matrix.print(twitterFollowers);
+
+  if ((--textX) < textMin) //This moves the "Twitter Followers" banner along as textX continually updates.
+  {
+    textX = matrix.width();
+  }
+}
+
+void drawYoutube(RGBmatrixPanel4 &matrix, const String &subCount)
+{
+  textMin = sizeof("YouTube Subscribers") * -8;
+  matrix.setTextSize(1);
+  matrix.setTextColor(matrix.Color444(0, 0, 7));
+  matrix.fillScreen(0);
+  drawBanner(matrix, "YouTube Subscribers", matrix.Color444(0, 0, 7));
+  matrix.drawImage(&icons, ICONS_YOUTUBE, 0, 9);
+  matrix.setCursor((matrix.width() / 2) - (sizeof(subCount) * 5 / 2) + (sizeof(subCount)) , 9); //*5 is used as each character is 5 led's accross. The additional sizeOf() is for the 1 led spaces between words.
+  matrix.print(subCount);
+
+  if ((--textX) < textMin) //This moves the "YouTube Subscribers" banner along as textX continually updates.
+  {
+    textX = matrix.width();
+  }
+}
+
+static uint8_t weatherIcon(const char *code) //Picks the atlas image for an OpenWeatherMap icon code such as "01d" or "10n".
+{
+  switch (atoi(code))
+  {
+  case 1:
+    return code[2] == 'n' ? ICONS_MOON : ICONS_SUN;
+  case 2:
+    return ICONS_SUN_CLOUD;
+  case 3:
+  case 4:
+    return ICONS_CLOUD;
+  case 9:
+  case 10:
+    return ICONS_RAIN;
+  case 11:
+    return ICONS_THUNDER;
+  case 13:
+    return ICONS_SNOW;
+  case 50:
+    return ICONS_MIST;
+  }
+  return 0xFF; //No icon yet, drawImage() ignores indexes past the end of the atlas.
+}
+
+void drawWeather(RGBmatrixPanel4 &matrix, const String &location, int main_temp, const char *icon)
+{
+  textMin = -(location.length())*5 - location.length();
+  matrix.setTextSize(1);
+  matrix.setTextColor(matrix.Color444(0, 7, 0));
+  matrix.fillScreen(0);
+  drawBanner(matrix, location.c_str(), matrix.Color444(0, 7, 0));
+  matrix.drawImage(&icons, weatherIcon(icon), 0, 9);
+  matrix.setCursor((matrix.width() / 2) - (sizeof(main_temp) * 5 / 2) + (sizeof(main_temp)), 9);
+  matrix.setTextColor(matrix.Color444(7, 7, 0));
+  matrix.printf("%dc", main_temp); //Special characters like degrees aren't included in the matrix's libary of characters
+
+  if ((--textX) < textMin) //This moves the location banner along as textX continually updates.
+  {
+    textX = matrix.width();
+  }
+}
+
+static uint8_t cryptoIcon(const char *name) //Coins without a logo of their own get a plain coin.
+{
+  if (strcmp(name, "Bitcoin") == 0)
+  {
+    return ICONS_BITCOIN;
+  }
+  if (strcmp(name, "Ethereum") == 0)
+  {
+    return ICONS_ETHEREUM;
+  }
+  return ICONS_COIN;
+}
+
+void drawCrypto(RGBmatrixPanel4 &matrix, const String &name, double price, double priceDiff)
+{
+  char priceDiffArrayLength[15], banner[64];
+  snprintf(priceDiffArrayLength, 15, "%.2lf%% ", priceDiff);
+  //priceDiff is converted to a formatted char here so the program can use strlen() to get the length of the text.
+
+  textMin = -(name.length())*5 - strlen(priceDiffArrayLength)*5 - name.length() - strlen(priceDiffArrayLength); 
+  //textMin is determined by the length of the message, * 5 to account for the length of words and then taken away by the length of the message to account for the 1 led spaces between each letter.
+
+  matrix.setTextSize(1);
+  matrix.setTextColor(matrix.Color444(0, 7, 0));
+  matrix.fillScreen(0);
+  snprintf(banner, sizeof(banner), "%s%s", priceDiffArrayLength, name.c_str());
+  //If the price difference is below 0, colour switch to red.
+  drawBanner(matrix, banner, priceDiff < 0 ? matrix.Color444(7, 0, 0) : matrix.Color444(0, 7, 0));
+  matrix.drawImage(&icons, cryptoIcon(name.c_str()), 0, 9);
+  matrix.setTextColor(matrix.Color444(7, 7, 0));
+  matrix.setCursor((64 / 2) - (sizeof(price) * 6 / 2), 9);
+  matrix.printf("%.2lf", price); //price rendered to 2 significant characters.
+
+  if ((--textX) < textMin) //This moves the location banner along as textX continually updates.
+  {
+    textX = matrix.width();
+  }
+}
@@ -0,0 +1,255 @@
+// RGBmatrixAnimation against the encoder in extras/host/matrixanim.h:
+// frames drawn into one matrix are encoded, played into another through
+// AnimStream, and each has to read back with getPixel() as drawn.  Files
+// cut short and files for other displays have to be refused, and
+// decoding has to keep a minimum pace.  "pio test -e native"; see
+// [env:native] in platformio.ini.
+
+#include <unity.h>
+#include <vector>
+#include <chrono>
+#include "RGBmatrixPanel4.h"
+#include "RGBmatrixAnimation.h"
+#include "matrixanim.h"
+
+#define PANELS      2
+#define ANIM_HEADER 14 // Bytes, see RGBmatrixAnimation.h
+
+// Decoding a frame of the scrolling banner in test_throughput() takes a
+// few microseconds on a desktop; this is far below that, but catches the
+// player falling back to a byte at a time or re-reading the stream.
+#define MIN_FRAMES_PER_SEC 20000
+
+typedef std::vector<uint16_t> Pixels;
+
+// As the display reads back, row by row
+static Pixels snapshot(RGBmatrixPanel4 &m)
+{
+	Pixels p;
+
+	for(int16_t y = 0; y < m.height(); y++)
+		for(int16_t x = 0; x < m.width(); x++) p.push_back(m.getPixel(x, y));
+	return p;
+}
+
+// A bit of everything the encoder makes: moving text and blocks, a frame
+// where every byte changes, one where none do and one with a single
+// changed pixel
+#define FRAMES 12
+
+static void drawFrame(RGBmatrixPanel4 &m, uint8_t f)
+{
+	int16_t w = m.width(), h = m.height();
+
+	if(f == 6)
+	{
+		m.fillScreen(m.Color333(1, 2, 3));
+		return;
+	}
+	if(f == 7) return;
+	if(f == 8)
+	{
+		m.drawPixel(w - 1, h - 1, 0xFFFF);
+		return;
+	}
+	m.fillScreen(0);
+	m.fillRect(f * 3, f % 4 * 2, 6, 5,
+	  m.Color333(f & 7, 7 - (f & 7), (f >> 1) & 7));
+	m.setTextColor(m.Color444(15, f, 15 - f));
+	m.setCursor(w - f * 4, 8);
+	m.print("12:34");
+}
+
+// Encode the frames, keeping what each looked like and where it ends
+static void encode(std::vector<uint8_t> &data, std::vector<Pixels> &expect,
+  std::vector<size_t> &ends)
+{
+	RGBmatrixPanel4 m(26, 4, 27, 14, 15, 13, false, PANELS);
+	AnimEncoder     encoder(m, 0);
+
+	m.setTextWrap(false);
+	for(uint8_t f = 0; f < FRAMES; f++)
+	{
+		drawFrame(m, f);
+		encoder.add();
+		expect.push_back(snapshot(m));
+		ends.push_back(encoder.data.size());
+	}
+	data = encoder.data;
+}
+
+void setUp(void) { }
+void tearDown(void) { }
+
+// Triple buffered, each frame is decoded over an older one brought up to
+// date by syncBackBuffer(), which copies only the rows flagged as changed
+// since: a row the player didn't flag would show in a later frame.  Also
+// before that copy, every pixel still differing from the frame queued has
+// to be in a row dirtyRows() reports.  (Not with RGBMATRIX_SHADOW, where
+// reading the back buffer then repacks those rows from the shadow, which
+// the player doesn't draw into.)
+static void test_frames(void)
+{
+	std::vector<uint8_t> data;
+	std::vector<Pixels>  expect;
+	std::vector<size_t>  ends;
+	RGBmatrixPanel4      m(26, 4, 27, 14, 15, 13, RGBMATRIX_TRIPLEBUF, PANELS);
+	RGBmatrixAnimation   anim(m);
+	RGBmatrixBitstream   b;
+	char                 msg[64];
+
+	m.begin();
+	encode(data, expect, ends);
+	AnimStream stream(data);
+	m.getBitstream(&b);
+	TEST_ASSERT_TRUE(anim.begin(stream));
+	for(uint8_t f = 0; f < FRAMES; f++)
+	{
+		(void)snprintf(msg, sizeof(msg), "frame %d", f);
+		TEST_ASSERT_TRUE_MESSAGE(anim.update(), msg);
+
+#if !RGBMATRIX_SHADOW
+		Pixels   back = snapshot(m);
+		uint32_t rows = m.dirtyRows();
+		for(size_t i = 0; i < back.size(); i++)
+		{
+			if(back[i] == expect[f][i]) continue;
+			(void)snprintf(msg, sizeof(msg), "frame %d, pixel %d,%d not dirty",
+			  f, (int)(i % m.width()), (int)(i / m.width()));
+			TEST_ASSERT_TRUE_MESSAGE(rows & (1UL << (i / m.width() % b.nrows)),
+			  msg);
+		}
+#endif
+
+		m.syncBackBuffer();
+		Pixels shown = snapshot(m);
+		for(size_t i = 0; i < shown.size(); i++)
+		{
+			(void)snprintf(msg, sizeof(msg), "frame %d, pixel %d,%d", f,
+			  (int)(i % m.width()), (int)(i / m.width()));
+			TEST_ASSERT_EQUAL_HEX16_MESSAGE(expect[f][i], shown[i], msg);
+		}
+	}
+	TEST_ASSERT_FALSE(anim.update()); // Last frame has had its time
+	TEST_ASSERT_FALSE(anim.playing());
+}
+
+// Cut at every byte: the frames before the cut play, the one it falls in
+// doesn't (nor does anything, cut in the header)
+static void test_truncated(void)
+{
+	std::vector<uint8_t> data, cut;
+	std::vector<Pixels>  expect;
+	std::vector<size_t>  ends;
+	RGBmatrixPanel4      m(26, 4, 27, 14, 15, 13, RGBMATRIX_TRIPLEBUF, PANELS);
+	RGBmatrixAnimation   anim(m);
+	char                 msg[64];
+
+	m.begin();
+	encode(data, expect, ends);
+	for(size_t n = 0; n < data.size(); n++)
+	{
+		cut.assign(data.begin(), data.begin() + n);
+		AnimStream stream(cut);
+		(void)snprintf(msg, sizeof(msg), "cut at %d", (int)n);
+		if(n < ANIM_HEADER)
+		{
+			TEST_ASSERT_FALSE_MESSAGE(anim.begin(stream), msg);
+			continue;
+		}
+		TEST_ASSERT_TRUE_MESSAGE(anim.begin(stream), msg);
+		uint8_t f;
+		for(f = 0; ends[f] <= n; f++)
+			TEST_ASSERT_TRUE_MESSAGE(anim.update(), msg);
+		TEST_ASSERT_FALSE_MESSAGE(anim.update(), msg);
+		TEST_ASSERT_FALSE_MESSAGE(anim.playing(), msg);
+	}
+}
+
+// A file only plays on the display it was made for
+static void test_geometry(void)
+{
+	std::vector<uint8_t> data, bad;
+	std::vector<Pixels>  expect;
+	std::vector<size_t>  ends;
+
+	encode(data, expect, ends);
+	{
+		RGBmatrixPanel4    m(26, 4, 27, 14, 15, 13, false, PANELS + 1);
+		RGBmatrixAnimation anim(m);
+		AnimStream         stream(data);
+		TEST_ASSERT_FALSE(anim.begin(stream));
+		TEST_ASSERT_FALSE(anim.playing());
+		TEST_ASSERT_FALSE(anim.update());
+	}
+	{
+		RGBmatrixPanel4    m(26, 4, 27, 2, 14, 15, 13, false, PANELS);
+		RGBmatrixAnimation anim(m);
+		AnimStream         stream(data);
+		TEST_ASSERT_FALSE(anim.begin(stream));
+	}
+	{
+		RGBmatrixPanel4    m(26, 4, 27, 14, 15, 13, false, PANELS);
+		RGBmatrixAnimation anim(m);
+		bad = data;
+		bad[4]++; // Color depth
+		AnimStream stream(bad);
+		TEST_ASSERT_FALSE(anim.begin(stream));
+		bad = data;
+		bad[0] = 'X';
+		AnimStream stream2(bad);
+		TEST_ASSERT_FALSE(anim.begin(stream2));
+		AnimStream stream3(data);
+		TEST_ASSERT_TRUE(anim.begin(stream3));
+	}
+}
+
+// A banner scrolling a column a frame, as extras/host/matrixbench.cpp's
+// "anim/update", played over and over for a while
+static void test_throughput(void)
+{
+	using namespace std::chrono;
+	RGBmatrixPanel4    m(26, 4, 27, 14, 15, 13, RGBMATRIX_TRIPLEBUF, PANELS);
+	const char        *banner = "Light rain and a moderate breeze this "
+	                            "afternoon, clearing from the west by evening";
+	GFXcanvas1         strip(strlen(banner) * 6, 8);
+	AnimEncoder        encoder(m, 0);
+	RGBmatrixAnimation anim(m);
+	uint32_t           frames = 0;
+	double             secs;
+	char               msg[64];
+
+	m.begin();
+	strip.setTextWrap(false);
+	strip.print(banner);
+	for(int16_t x = 0; x < 64; x++)
+	{
+		m.drawScroll(&strip, 4, x, 0xFFFF, 0);
+		encoder.add();
+	}
+	AnimStream stream(encoder.data);
+
+	steady_clock::time_point t0 = steady_clock::now();
+	do
+	{
+		stream.rewind();
+		TEST_ASSERT_TRUE(anim.begin(stream));
+		while(anim.update()) frames++;
+		secs = duration<double>(steady_clock::now() - t0).count();
+	} while(secs < 0.2);
+
+	(void)snprintf(msg, sizeof(msg), "%.0f frames/s", frames / secs);
+	TEST_MESSAGE(msg);
+	TEST_ASSERT_TRUE_MESSAGE(frames / secs >= MIN_FRAMES_PER_SEC, msg);
+}
+
+int main(int argc, char **argv)
+{
+	(void)argc; (void)argv;
+	UNITY_BEGIN();
+	RUN_TEST(test_frames);
+	RUN_TEST(test_truncated);
+	RUN_TEST(test_geometry);
+	RUN_TEST(test_throughput);
+	return UNITY_END();
+}
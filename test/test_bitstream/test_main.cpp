@@ -0,0 +1,242 @@
+// updateDisplay() against RGBmatrixBitstream, write for write: every
+// store the interrupt handler makes to the port stand-ins (the per pin
+// registers in Arduino.h and GPIO.out_w1ts/out_w1tc, see
+// extras/host/host.cpp) is recorded as a sample of all 13 signals, and a
+// full refresh cycle of them has to be what generate() makes of the same
+// frame buffer, interrupt by interrupt.  "pio test -e native"; see
+// [env:native] in platformio.ini.
+//
+// Writes are caught by making the stand-ins' memory read-only: the fault
+// handler opens it up and single steps the storing instruction, and the
+// trap after it reads the register back.  That needs Linux on x86-64;
+// elsewhere the test is ignored.
+
+#include <unity.h>
+#include <vector>
+#include "RGBmatrixPanel4.h"
+#include "driver/gpio.h"
+
+#if defined(__linux__) && defined(__x86_64__)
+#include <signal.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+#define WATCH_WRITES
+#endif
+
+#define PIN_SCLK  14
+#define PIN_LATCH 15
+#define PIN_OE    13
+#define PIN_A     26
+#define PIN_B      4
+#define PIN_C     27
+#define PIN_D      2
+
+// Sample bit order of RGBmatrixBitstream's defaults (R1, G1, B1, R2, G2,
+// B2, CLK, LAT, OE, A, B, C, D), with the constructor's default RGB pins
+static const uint8_t pins[13] = { 5, 17, 18, 19, 16, 25, PIN_SCLK,
+  PIN_LATCH, PIN_OE, PIN_A, PIN_B, PIN_C, PIN_D };
+
+#ifdef WATCH_WRITES
+
+#define TRAP_FLAG 0x100 // EFLAGS.TF
+
+static uintptr_t              page[2];    // Holding host_port and GPIO
+static long                   pagesize;
+static volatile uint32_t     *target;     // Register being stored to
+static uint32_t               gpiolevel;  // Pin levels behind out_w1ts/tc
+static std::vector<uint16_t>  samples;
+
+static void protect(int prot)
+{
+	for(uint8_t i = 0; i < 2; i++)
+		(void)mprotect((void *)page[i], pagesize, prot);
+}
+
+static bool watched(volatile void *p)
+{
+	uintptr_t a = (uintptr_t)p & ~(uintptr_t)(pagesize - 1);
+
+	return (a == page[0]) || (a == page[1]);
+}
+
+static uint16_t sample(void)
+{
+	uint16_t s = 0;
+
+	for(uint8_t i = 0; i < 13; i++)
+	{
+		uint32_t level = (i <= 6) ? gpiolevel : host_port[pins[i]];
+		if(level & digitalPinToBitMask(pins[i])) s |= 1 << i;
+	}
+	return s;
+}
+
+static void onFault(int sig, siginfo_t *info, void *context)
+{
+	ucontext_t *uc = (ucontext_t *)context;
+
+	if(!watched(info->si_addr))
+	{
+		signal(sig, SIG_DFL); // A real crash; let it happen
+		return;
+	}
+	protect(PROT_READ | PROT_WRITE);
+	target = (volatile uint32_t *)info->si_addr;
+	uc->uc_mcontext.gregs[REG_EFL] |= TRAP_FLAG;
+}
+
+// The store has been made.  Other things sharing the pages are let
+// through unrecorded, as are registers of pins not in the list.
+static void onStep(int, siginfo_t *, void *context)
+{
+	ucontext_t *uc = (ucontext_t *)context;
+	bool        pin = false;
+
+	uc->uc_mcontext.gregs[REG_EFL] &= ~TRAP_FLAG;
+	if(target == &GPIO.out_w1ts)
+	{
+		gpiolevel |= GPIO.out_w1ts;
+		pin = true;
+	}
+	else if(target == &GPIO.out_w1tc)
+	{
+		gpiolevel &= ~GPIO.out_w1tc;
+		pin = true;
+	}
+	else
+	{
+		for(uint8_t i = 7; i < 13; i++)
+			if(target == &host_port[pins[i]]) pin = true;
+	}
+	if(pin) samples.push_back(sample());
+	protect(PROT_READ);
+}
+
+static void watch(bool on)
+{
+	struct sigaction sa;
+
+	if(on)
+	{
+		pagesize = sysconf(_SC_PAGESIZE);
+		page[0]  = (uintptr_t)host_port & ~(uintptr_t)(pagesize - 1);
+		page[1]  = (uintptr_t)&GPIO & ~(uintptr_t)(pagesize - 1);
+		memset(&sa, 0, sizeof(sa));
+		sa.sa_flags     = SA_SIGINFO;
+		sa.sa_sigaction = onFault;
+		sigaction(SIGSEGV, &sa, NULL);
+		sa.sa_sigaction = onStep;
+		sigaction(SIGTRAP, &sa, NULL);
+		protect(PROT_READ);
+	}
+	else
+	{
+		protect(PROT_READ | PROT_WRITE);
+		signal(SIGSEGV, SIG_DFL);
+		signal(SIGTRAP, SIG_DFL);
+	}
+}
+
+#endif // WATCH_WRITES
+
+// Something in every plane: all hues at full and partial brightness, a
+// gradient through every level and text (as extras/host/matrixsim.cpp)
+static void draw(RGBmatrixPanel4 &m)
+{
+	int16_t w = m.width(), h = m.height();
+
+	for(int16_t x = 0; x < w; x++)
+	{
+		uint8_t hue = x * 6 / w;
+		m.drawFastVLine(x, 0, h / 4,
+		  m.Color333(hue & 1 ? 7 : 0, hue & 2 ? 7 : 0, hue & 4 ? 7 : 0));
+		m.drawPixel(x, h / 4, m.Color888(x * 255 / (w - 1),
+		  255 - x * 255 / (w - 1), (x & 1) * 128, true));
+	}
+	m.setTextColor(m.Color444(15, 15, 15));
+	m.setCursor(1, h / 4 + 2);
+	m.print("12:34");
+}
+
+static void check(bool tall, uint8_t dbuf, uint8_t panels)
+{
+#ifdef WATCH_WRITES
+	RGBmatrixPanel4 *m = tall ?
+	  new RGBmatrixPanel4(PIN_A, PIN_B, PIN_C, PIN_D, PIN_SCLK, PIN_LATCH,
+	                      PIN_OE, dbuf, panels) :
+	  new RGBmatrixPanel4(PIN_A, PIN_B, PIN_C, PIN_SCLK, PIN_LATCH, PIN_OE,
+	                      dbuf, panels);
+	RGBmatrixBitstream bitstream;
+	std::vector<size_t> calls; // First sample of each interrupt
+	char                msg[64];
+
+	m->begin();
+	draw(*m);
+	m->requestSwap(); // Single buffered; expanded needs it to show
+	m->getBitstream(&bitstream);
+	// No padding: samples are exactly the register writes
+	memset(bitstream.duration, 0, sizeof(bitstream.duration));
+	memset(bitstream.blank, 0, sizeof(bitstream.blank));
+
+	size_t                n = bitstream.generate(m->backBuffer(), NULL, 0);
+	std::vector<uint16_t> expect(n);
+	uint16_t              cycle = bitstream.nrows * bitstream.nplanes;
+	bitstream.generate(m->backBuffer(), expect.data(), n);
+
+	// Two refresh cycles: the first brings the pin levels to where a
+	// cycle ends, which is where generate() starts from
+	samples.clear();
+	samples.reserve(4 * n);
+	gpiolevel = 0;
+	watch(true);
+	for(uint16_t i = 0; i < 2 * cycle; i++)
+	{
+		calls.push_back(samples.size());
+		m->updateDisplay();
+	}
+	calls.push_back(samples.size());
+	watch(false);
+	m->end();
+	delete m;
+
+	TEST_ASSERT_EQUAL_MESSAGE(n, calls[2 * cycle] - calls[cycle],
+	  "samples per refresh cycle");
+	for(uint16_t i = 0; i < cycle; i++)
+	{
+		size_t at = calls[cycle + i], len = calls[cycle + i + 1] - at,
+		       from = at - calls[cycle];
+		(void)snprintf(msg, sizeof(msg), "row %d plane %d",
+		  i / bitstream.nplanes, i % bitstream.nplanes);
+		TEST_ASSERT_TRUE_MESSAGE(from + len <= n, msg);
+		TEST_ASSERT_EQUAL_HEX16_ARRAY_MESSAGE(&expect[from], &samples[at],
+		  len, msg);
+	}
+#else
+	(void)tall; (void)dbuf; (void)panels;
+	TEST_IGNORE_MESSAGE("recording port writes needs Linux on x86-64");
+#endif
+}
+
+void setUp(void) { }
+void tearDown(void) { }
+
+static void test_16x32_1(void)          { check(false, false, 1); }
+static void test_16x32_2(void)          { check(false, false, 2); }
+static void test_16x32_3(void)          { check(false, false, 3); }
+static void test_16x32_2_expanded(void) { check(false, RGBMATRIX_EXPANDED, 2); }
+static void test_32x32_1(void)          { check(true, false, 1); }
+static void test_32x32_2_expanded(void) { check(true, RGBMATRIX_EXPANDED, 2); }
+
+int main(int argc, char **argv)
+{
+	(void)argc; (void)argv;
+	UNITY_BEGIN();
+	RUN_TEST(test_16x32_1);
+	RUN_TEST(test_16x32_2);
+	RUN_TEST(test_16x32_3);
+	RUN_TEST(test_16x32_2_expanded);
+	RUN_TEST(test_32x32_1);
+	RUN_TEST(test_32x32_2_expanded);
+	return UNITY_END();
+}
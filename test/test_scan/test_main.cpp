@@ -0,0 +1,146 @@
+// setScanPattern(): every scan rate a panel height allows, with both
+// built-in wirings, on a chain of two panels.  Each pixel is drawn alone
+// with drawPixel(), and where its bits land in the frame buffer is worked
+// back to an LED position by a decoder written from the panels' wiring
+// (below), not from the driver's maps; that has to be the pixel drawn.
+// "pio test -e native"; see [env:native] in platformio.ini.
+
+#include <unity.h>
+#include "RGBmatrixPanel4.h"
+
+#define PANELS 2
+
+static uint8_t          scanRows;  // Row addresses
+static RGBmatrixScanMap scanMap;
+
+// An LED pair's place in the chain as the panels are wired.  The data for
+// a row address goes through one shift register per half: 32 * nmux LEDs
+// per panel, the first panel's first.  Snake: columns in blocks of 8, each
+// block visiting the nmux rows from the bottom one up, a run of 8 LEDs on
+// each.  Linear: whole rows, again from the bottom one up.  Row 'mux' of
+// the rows sharing address 'addr' is physical row mux * scan + addr.
+static void wiring(uint16_t pair, uint8_t addr, uint8_t nmux,
+  int16_t *x, int16_t *y)
+{
+	uint16_t panel = pair / (32 * nmux), pos = pair % (32 * nmux), run;
+	uint8_t  col;
+
+	if(scanMap == RGBmatrixScanSnake)
+	{
+		run = pos / 8;
+		col = (run / nmux) * 8 + pos % 8;
+		run = run % nmux;
+	}
+	else
+	{
+		run = pos / 32;
+		col = pos % 32;
+	}
+	*x = panel * 32 + col;
+	*y = (nmux - 1 - run) * scanRows + addr;
+}
+
+// The one LED pair lit in the buffer, and which half: the upper half's
+// R1, G1, B1 are bits 2-4 of each plane byte, the lower half's bits 5-7.
+static void decode(const uint8_t *buf, uint32_t size, uint16_t stride,
+  uint8_t planebytes, uint8_t nmux, int16_t *x, int16_t *y)
+{
+	uint32_t rowbytes = (uint32_t)planebytes * stride, i, found = 0;
+	int16_t  lx = -1, ly = -1, half = nmux * scanRows;
+
+	for(i = 0; i < size; i++)
+	{
+		if(!buf[i]) continue;
+		TEST_ASSERT_TRUE_MESSAGE(!(buf[i] & 0x1C) != !(buf[i] & 0xE0),
+		  "bits in both halves");
+		wiring((i % rowbytes) % stride, i / rowbytes, nmux, x, y);
+		if(buf[i] & 0xE0) *y += half;
+		if(found++)
+		{
+			TEST_ASSERT_EQUAL_MESSAGE(lx, *x, "planes disagree");
+			TEST_ASSERT_EQUAL_MESSAGE(ly, *y, "planes disagree");
+		}
+		lx = *x;
+		ly = *y;
+	}
+	TEST_ASSERT_EQUAL_MESSAGE(planebytes, found, "plane bytes set");
+}
+
+static void check(bool tall, uint8_t scan, RGBmatrixScanMap map)
+{
+	// Pin numbers only matter on the target
+	RGBmatrixPanel4 *m = tall ?
+	  new RGBmatrixPanel4(26, 4, 27, 2, 14, 15, 13, false, PANELS) :
+	  new RGBmatrixPanel4(26, 4, 27,    14, 15, 13, false, PANELS);
+	int16_t  w = m->width(), h = m->height(), x, y, dx, dy;
+	uint8_t  nmux = h / 2 / scan;
+	uint16_t stride = 32 * nmux * PANELS;
+	uint32_t size = (uint32_t)scan * RGBMATRIX_PLANEBYTES * stride;
+	char     msg[64];
+
+	scanRows = scan;
+	scanMap  = map;
+	TEST_ASSERT_TRUE(m->setScanPattern(scan, map));
+	for(y = 0; y < h; y++)
+	{
+		for(x = 0; x < w; x++)
+		{
+			m->fillScreen(0);
+			m->drawPixel(x, y, 0xFFFF);
+			m->requestSwap(); // Packs the shadow buffer, if there is one
+			(void)snprintf(msg, sizeof(msg), "1/%d scan, pixel %d,%d",
+			  scan, x, y);
+			decode(m->backBuffer(), size, stride, RGBMATRIX_PLANEBYTES, nmux,
+			  &dx, &dy);
+			TEST_ASSERT_EQUAL_MESSAGE(x, dx, msg);
+			TEST_ASSERT_EQUAL_MESSAGE(y, dy, msg);
+		}
+	}
+	delete m;
+}
+
+void setUp(void) { }
+void tearDown(void) { }
+
+static void test_16_rows(void)
+{
+	static const uint8_t scans[] = { 2, 4, 8 };
+
+	for(uint8_t i = 0; i < sizeof(scans); i++)
+	{
+		check(false, scans[i], RGBmatrixScanSnake);
+		check(false, scans[i], RGBmatrixScanLinear);
+	}
+}
+
+static void test_32_rows(void)
+{
+	static const uint8_t scans[] = { 2, 4, 8, 16 };
+
+	for(uint8_t i = 0; i < sizeof(scans); i++)
+	{
+		check(true, scans[i], RGBmatrixScanSnake);
+		check(true, scans[i], RGBmatrixScanLinear);
+	}
+}
+
+// Scan rates the panel can't have are refused
+static void test_rejected(void)
+{
+	RGBmatrixPanel4 m(26, 4, 27, 14, 15, 13, false, PANELS);
+
+	TEST_ASSERT_FALSE(m.setScanPattern(16, RGBmatrixScanSnake));
+	TEST_ASSERT_FALSE(m.setScanPattern(3, RGBmatrixScanSnake));
+	TEST_ASSERT_FALSE(m.setScanPattern(1, RGBmatrixScanSnake));
+	TEST_ASSERT_FALSE(m.setScanPattern(4, NULL));
+}
+
+int main(int argc, char **argv)
+{
+	(void)argc; (void)argv;
+	UNITY_BEGIN();
+	RUN_TEST(test_16_rows);
+	RUN_TEST(test_32_rows);
+	RUN_TEST(test_rejected);
+	return UNITY_END();
+}
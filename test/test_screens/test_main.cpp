@@ -0,0 +1,157 @@
+// The clock's screens (src/screens.cpp) against reference images: each is
+// drawn from fixed values, as loop() would after fetching them, read back
+// with getPixel() and compared pixel for pixel with the PPM of the same
+// name in this directory.  "pio test -e native"; see [env:native] in
+// platformio.ini.
+//
+// After a deliberate change to how a screen looks, run the tests with
+// RGBMATRIX_UPDATE_IMAGES=1 in the environment to write new references,
+// and check them (any image viewer reads PPM) before committing them.
+// A failing screen is also written to <name>-actual.ppm in the current
+// directory (the project folder, where pio runs the tests) for comparison.
+
+#include <unity.h>
+#include <string>
+#include "RGBmatrixPanel4.h"
+#include "screens.h"
+
+static RGBmatrixPanel4 *matrix;
+
+// This file's directory, where the references are
+static std::string here(void)
+{
+	std::string path = __FILE__;
+	size_t      end  = path.find_last_of("/\\");
+
+	return (end == std::string::npos) ? "." : path.substr(0, end);
+}
+
+// The display as 8 bit RGB, one pixel per LED
+static std::string render(RGBmatrixPanel4 &m)
+{
+	int16_t     w = m.width(), h = m.height();
+	std::string ppm = "P6\n" + std::to_string(w) + " " + std::to_string(h) +
+	                  "\n255\n";
+
+	for(int16_t y = 0; y < h; y++)
+	{
+		for(int16_t x = 0; x < w; x++)
+		{
+			uint16_t c = m.getPixel(x, y);
+			ppm += (char)(((c >> 11) & 0x1F) * 255 / 31);
+			ppm += (char)(((c >>  5) & 0x3F) * 255 / 63);
+			ppm += (char)(( c        & 0x1F) * 255 / 31);
+		}
+	}
+	return ppm;
+}
+
+static bool readFile(const std::string &name, std::string &data)
+{
+	FILE  *f = fopen(name.c_str(), "rb");
+	char   buf[4096];
+	size_t n;
+
+	if(!f) return false;
+	data.clear();
+	while((n = fread(buf, 1, sizeof(buf), f)) > 0) data.append(buf, n);
+	(void)fclose(f);
+	return true;
+}
+
+static bool writeFile(const std::string &name, const std::string &data)
+{
+	FILE *f = fopen(name.c_str(), "wb");
+
+	if(!f) return false;
+	(void)fwrite(data.data(), 1, data.size(), f);
+	return fclose(f) == 0;
+}
+
+static void compare(const char *name)
+{
+	std::string path = here() + "/" + name + ".ppm", actual = render(*matrix),
+	            expect;
+	const char *update = getenv("RGBMATRIX_UPDATE_IMAGES");
+	char        msg[96];
+
+	if(update && (*update == '1'))
+	{
+		TEST_ASSERT_TRUE_MESSAGE(writeFile(path, actual), path.c_str());
+		return;
+	}
+	(void)snprintf(msg, sizeof(msg), "no reference %s.ppm", name);
+	TEST_ASSERT_TRUE_MESSAGE(readFile(path, expect), msg);
+	if(actual == expect) return;
+
+	(void)writeFile(std::string(name) + "-actual.ppm", actual);
+	(void)snprintf(msg, sizeof(msg), "%s differs from %s.ppm, see %s-actual.ppm",
+	  name, name, name);
+	if(actual.size() == expect.size())
+	{
+		size_t  header = actual.size() - 3 * matrix->width() * matrix->height(),
+		        i;
+		for(i = header; actual[i] == expect[i]; i++);
+		(void)snprintf(msg, sizeof(msg), "%s differs from %s.ppm at %d,%d",
+		  name, name, (int)((i - header) / 3 % matrix->width()),
+		  (int)((i - header) / 3 / matrix->width()));
+	}
+	TEST_FAIL_MESSAGE(msg);
+}
+
+// As src/main.cpp sets it up, the banners a few LEDs in from the left
+void setUp(void)
+{
+	matrix = new RGBmatrixPanel4(26, 4, 27, 14, 15, 13, RGBMATRIX_TRIPLEBUF, 2);
+	matrix->begin();
+	matrix->setTextWrap(false);
+	textX = 4;
+}
+
+void tearDown(void)
+{
+	matrix->end();
+	delete matrix;
+}
+
+static void test_time(void)
+{
+	drawTime(*matrix, 9, 5, 7.9, "Wednesday");
+	compare("time");
+}
+
+static void test_twitter(void)
+{
+	drawTwitter(*matrix, 12345);
+	compare("twitter");
+}
+
+static void test_youtube(void)
+{
+	drawYoutube(*matrix, "1234567");
+	compare("youtube");
+}
+
+static void test_weather(void)
+{
+	drawWeather(*matrix, "Aberystwyth", 14, "10d");
+	compare("weather");
+}
+
+static void test_crypto(void)
+{
+	drawCrypto(*matrix, "Bitcoin", 28123.45, -1.23);
+	compare("crypto");
+}
+
+int main(int argc, char **argv)
+{
+	(void)argc; (void)argv;
+	UNITY_BEGIN();
+	RUN_TEST(test_time);
+	RUN_TEST(test_twitter);
+	RUN_TEST(test_youtube);
+	RUN_TEST(test_weather);
+	RUN_TEST(test_crypto);
+	return UNITY_END();
+}